@@ -0,0 +1,217 @@
+#include "BatchPlanner.h"
+#include "DeliveryFile.h"
+#include "PlanEncoding.h"
+#include "WorkerPool.h"
+#include "ExpandableHashMap.h"
+#include "Trace.h"
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+using namespace std;
+
+static bool isDirectory(const string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static long long fileSize(const string& path)
+{
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0 ? st.st_size : 0);
+}
+
+static string baseName(const string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return (slash == string::npos ? path : path.substr(slash + 1));
+}
+
+bool findDeliveryFiles(const string& dirOrManifest, vector<string>& files)
+{
+    if (isDirectory(dirOrManifest))
+    {
+        DIR* dir = opendir(dirOrManifest.c_str());
+        if (dir == nullptr)
+            return false;
+        vector<string> found;
+        while (dirent* entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            string path = dirOrManifest + "/" + name;
+            if (name[0] != '.' && !isDirectory(path))
+                found.push_back(path);
+        }
+        closedir(dir);
+        sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+        return true;
+    }
+
+    ifstream manifest(dirOrManifest);
+    if (!manifest)
+        return false;
+    size_t slash = dirOrManifest.find_last_of('/');
+    string base = (slash == string::npos ? "" : dirOrManifest.substr(0, slash + 1));
+    string line;
+    while (getline(manifest, line))
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos)
+            continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        string path = line.substr(start, end - start + 1);
+        files.push_back(path[0] == '/' ? path : base + path);
+    }
+    return true;
+}
+
+  // Plan one file and write what the command line program would print,
+  // including its complaints about malformed lines, which go in the file's
+  // own output rather than to cout, where files planned at the same time
+  // would mix them up.
+static void planOne(const ConfigurableDeliveryPlanner& planner, const string& input, const string& output,
+                    BatchResult& r)
+{
+    TraceSpan span("plan file");
+    span.arg("file", input);
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+    string text;
+    MappedDeliveries file;
+    r.loaded = file.open(input);
+    if (r.loaded)
+    {
+        const vector<DeliveryLineError>& errors = file.errors();
+        for (int i = 0; i < errors.size(); i++)
+            text += errors[i].message + " in deliveries file line " + to_string(errors[i].line) + ": " + errors[i].text + "\n";
+        r.loaded = file.toRequests(depot, deliveries);
+    }
+    r.deliveries = static_cast<int>(deliveries.size());
+    r.result = NO_ROUTE;
+    r.miles = 0;
+
+    if (!r.loaded)
+        text += "Unable to load delivery request file " + input + "\n";
+    else
+    {
+        NameTable names;
+        vector<PlanCommand> commands;
+        double miles = 0;
+        auto keepLeg = [&commands, &miles](int /*leg*/, const vector<PlanCommand>& legCommands, double legMiles)
+        {
+            commands.insert(commands.end(), legCommands.begin(), legCommands.end());
+            miles += legMiles;
+        };
+        r.result = planner.streamDeliveryPlan(depot, deliveries, names, keepLeg);
+        if (r.result == BAD_COORD)
+            text += "One or more depot or delivery coordinates are invalid.\n";
+        else if (r.result == NO_ROUTE)
+            text += "No route can be found to deliver all items.\n";
+        else
+        {
+            r.miles = miles;
+            text += "Starting at the depot...\n";
+            formatCommands(commands, names, text);
+            text += "You are back at the depot and your deliveries are done!\n";
+            char total[64];
+            snprintf(total, sizeof(total), "%.2f", miles);
+            text += total;
+            text += " miles travelled for all deliveries.\n";
+        }
+    }
+
+    ofstream outf(output);
+    outf << text;
+    if (!outf)
+        cerr << "Unable to write plan file " << output << endl;
+}
+
+void planBatch(const StreetMap* sm, const PlannerOptions& options, int threads,
+               const vector<string>& inputs, const string& outDir,
+               vector<BatchResult>& results)
+{
+    int n = static_cast<int>(inputs.size());
+    results.assign(n, BatchResult());
+    mkdir(outDir.c_str(), 0777); // fine if it's already there
+
+      // Outputs are named after their inputs; a name seen before gets a
+      // number, so files with the same name in different directories don't
+      // overwrite each other's plans.
+    ExpandableHashMap<string, int> seen;
+    for (int i = 0; i < n; i++)
+    {
+        string name = baseName(inputs[i]);
+        int* count = seen.find(name);
+        if (count == nullptr)
+            seen.associate(name, 1);
+        else
+            name += "-" + to_string(++*count);
+        results[i].input = inputs[i];
+        results[i].output = outDir + "/" + name + ".plan";
+    }
+
+    vector<int> order(n);
+    vector<long long> sizes(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+        sizes[i] = fileSize(inputs[i]);
+    }
+    stable_sort(order.begin(), order.end(), [&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+    PlannerOptions planOptions = options;
+    planOptions.routingThreads = 1; // the threads go to files instead
+    ConfigurableDeliveryPlanner planner(sm, planOptions);
+    WorkerPool pool(threads);
+    pool.run(n, [&](int k)
+    {
+        BatchResult& r = results[order[k]];
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        planOne(planner, r.input, r.output, r);
+        r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    });
+}
+
+  // The nearest-rank percentile of sorted values.
+static double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    int rank = static_cast<int>(ceil(p / 100 * sorted.size()));
+    return sorted[max(rank, 1) - 1];
+}
+
+void printBatchReport(const vector<BatchResult>& results, double wallSeconds, int threads, ostream& out)
+{
+    int planned = 0;
+    long long deliveries = 0;
+    vector<double> latencies;
+    for (int i = 0; i < results.size(); i++)
+    {
+        const BatchResult& r = results[i];
+        if (r.loaded && r.result == DELIVERY_SUCCESS)
+        {
+            planned++;
+            deliveries += r.deliveries;
+        }
+        else
+            out << "Not planned: " << r.input << " (see " << r.output << ")" << endl;
+        latencies.push_back(r.seconds * 1000);
+    }
+    sort(latencies.begin(), latencies.end());
+
+    char line[256];
+    snprintf(line, sizeof(line), "Planned %d of %d files in %.2f s on %d threads: %.1f plans/s, %.0f deliveries/s",
+             planned, static_cast<int>(results.size()), wallSeconds, threads,
+             (wallSeconds > 0 ? planned / wallSeconds : 0), (wallSeconds > 0 ? deliveries / wallSeconds : 0));
+    out << line << endl;
+    snprintf(line, sizeof(line), "Per-file latency: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms",
+             percentile(latencies, 50), percentile(latencies, 95), percentile(latencies, 99),
+             (latencies.empty() ? 0 : latencies.back()));
+    out << line << endl;
+}
@@ -0,0 +1,42 @@
+#ifndef BATCHPLANNER_INCLUDED
+#define BATCHPLANNER_INCLUDED
+
+#include "provided.h"
+#include "PlannerOptions.h"
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Planning many deliveries files at once, such as every driver's file at
+// dispatch time, against one loaded map.
+
+struct BatchResult
+{
+    std::string input;
+    std::string output;         // where the plan (or why there isn't one) was written
+    bool loaded;                // false if input couldn't be read
+    DeliveryResult result;
+    int deliveries;
+    double miles;
+    double seconds;             // reading, planning and writing this file
+};
+
+  // The files to plan. A directory gives every file in it (not those whose
+  // names start with '.'), by name; a manifest lists one path per line, with
+  // relative paths taken from the manifest's directory. Returns false if
+  // dirOrManifest can't be read.
+bool findDeliveryFiles(const std::string& dirOrManifest, std::vector<std::string>& files);
+
+  // Plan each input on up to threads threads, writing each plan, in the
+  // command line program's format, to its own file in outDir (made if need
+  // be). results[i] describes inputs[i]. Idle threads take the next file
+  // still unstarted, largest first, so a few big files don't all end up
+  // last. Every thread shares sm and one planner made with options.
+void planBatch(const StreetMap* sm, const PlannerOptions& options, int threads,
+               const std::vector<std::string>& inputs, const std::string& outDir,
+               std::vector<BatchResult>& results);
+
+  // Throughput over wallSeconds and per-file latency percentiles.
+void printBatchReport(const std::vector<BatchResult>& results, double wallSeconds, int threads, std::ostream& out);
+
+#endif // BATCHPLANNER_INCLUDED
@@ -0,0 +1,179 @@
+#include "Clustering.h"
+#include <random>
+#include <limits>
+using namespace std;
+
+namespace
+{
+      // Assignment/update rounds before k-medoids gives up on converging.
+    const int KMEDOIDS_ROUNDS = 10;
+
+    const double INF = numeric_limits<double>::infinity();
+
+      // Uniform in [0, 1), done by hand for the same reason as the optimizer's.
+    double generateRand(mt19937_64& rng)
+    {
+        return (rng() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+      // k-means++ seeding: each new medoid is drawn with probability
+      // proportional to its squared distance from the nearest one so far.
+    vector<int> seedMedoids(const DistanceMatrix& d, int clusters, mt19937_64& rng)
+    {
+        int n = d.size() - 1;
+        vector<int> medoids;
+        medoids.push_back(1 + static_cast<int>(generateRand(rng) * n));
+        vector<double> nearest(n + 1, INF);
+        while (medoids.size() < clusters)
+        {
+            int last = medoids.back();
+            double total = 0;
+            for (int s = 1; s <= n; s++)
+            {
+                double miles = d(last, s);
+                if (miles * miles < nearest[s])
+                    nearest[s] = miles * miles;
+                total += nearest[s];
+            }
+            if (total <= 0)
+                break; // every stop sits on a medoid already
+            double target = generateRand(rng) * total;
+            int pick = n;
+            for (int s = 1; s <= n; s++)
+            {
+                target -= nearest[s];
+                if (target < 0)
+                {
+                    pick = s;
+                    break;
+                }
+            }
+            medoids.push_back(pick);
+        }
+        return medoids;
+    }
+}
+
+vector<vector<int> > clusterStops(const DistanceMatrix& d, int clusters, unsigned long long seed)
+{
+    int n = d.size() - 1;
+    vector<vector<int> > groups;
+    if (n < 1 || clusters < 1)
+        return groups;
+
+    mt19937_64 rng(seed);
+    vector<int> medoids = seedMedoids(d, min(clusters, n), rng);
+    for (int round = 0; round < KMEDOIDS_ROUNDS; round++)
+    {
+          // Assign each stop to its nearest medoid.
+        groups.assign(medoids.size(), vector<int>());
+        for (int s = 1; s <= n; s++)
+        {
+            int best = 0;
+            for (int c = 1; c < medoids.size(); c++)
+                if (d(medoids[c], s) < d(medoids[best], s))
+                    best = c;
+            groups[best].push_back(s);
+        }
+
+          // Move each medoid to the member closest to the rest of its group.
+        bool changed = false;
+        for (int c = 0; c < groups.size(); c++)
+        {
+            const vector<int>& g = groups[c];
+            int best = medoids[c];
+            double bestSum = INF;
+            for (int i = 0; i < g.size(); i++)
+            {
+                double sum = 0;
+                for (int j = 0; j < g.size() && sum < bestSum; j++)
+                    sum += d(g[i], g[j]);
+                if (sum < bestSum)
+                {
+                    bestSum = sum;
+                    best = g[i];
+                }
+            }
+            if (best != medoids[c])
+            {
+                medoids[c] = best;
+                changed = true;
+            }
+        }
+        if (!changed)
+            break;
+    }
+
+      // The update step always picks a member, so each medoid is in its own
+      // group. Put it first, and drop groups that ended up empty.
+    vector<vector<int> > result;
+    for (int c = 0; c < groups.size(); c++)
+    {
+        if (groups[c].empty())
+            continue;
+        vector<int> g(1, medoids[c]);
+        for (int i = 0; i < groups[c].size(); i++)
+            if (groups[c][i] != medoids[c])
+                g.push_back(groups[c][i]);
+        result.push_back(g);
+    }
+    return result;
+}
+
+DistanceMatrix subMatrix(const DistanceMatrix& d, const vector<int>& nodes)
+{
+    int m = static_cast<int>(nodes.size());
+    DistanceMatrix sub;
+    sub.resize(m, d.symmetric());
+    for (int i = 0; i < m; i++)
+    {
+        const double* row = d.row(nodes[i]);
+        for (int j = 0; j < m; j++)
+            sub.set(i, j, row[nodes[j]]);
+    }
+    return sub;
+}
+
+void appendOpenedCycle(const DistanceMatrix& d, const vector<int>& cycle, int from, int to, vector<int>& tour)
+{
+    int m = static_cast<int>(cycle.size());
+    if (m == 0)
+        return;
+
+      // Cutting the edge cycle[i] -> cycle[i+1] and driving forward enters at
+      // cycle[i+1] and leaves from cycle[i]; driving backward enters at
+      // cycle[i] and leaves from cycle[i+1].
+    int bestCut = 0;
+    bool bestForward = true;
+    double bestCost = INF;
+    for (int i = 0; i < m; i++)
+    {
+        int a = cycle[i];
+        int b = cycle[(i + 1) % m];
+        double forward = d(from, b) + d(a, to) - d(a, b);
+        if (forward < bestCost)
+        {
+            bestCost = forward;
+            bestCut = i;
+            bestForward = true;
+        }
+        if (d.symmetric())
+        {
+            double backward = d(from, a) + d(b, to) - d(a, b);
+            if (backward < bestCost)
+            {
+                bestCost = backward;
+                bestCut = i;
+                bestForward = false;
+            }
+        }
+    }
+
+    for (int k = 0; k < m; k++)
+    {
+        if (bestForward)
+            tour.push_back(cycle[(bestCut + 1 + k) % m]);
+        else
+            tour.push_back(cycle[(bestCut - k + m) % m]);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef CLUSTERING_INCLUDED
+#define CLUSTERING_INCLUDED
+
+#include "DistanceMatrix.h"
+#include <vector>
+
+// Spatial decomposition for large batches: split the stops into groups of
+// nearby stops that can be toured separately, then join the groups' tours.
+
+  // Split stops 1..n of d into at most `clusters` groups with k-medoids, the
+  // k-means analogue that needs only distances, so it works for road
+  // distances as well as crow-flies. Each group lists its medoid first.
+std::vector<std::vector<int> > clusterStops(const DistanceMatrix& d, int clusters, unsigned long long seed);
+
+  // The matrix of distances between the given nodes of d, in that order, so
+  // nodes[0] becomes node 0.
+DistanceMatrix subMatrix(const DistanceMatrix& d, const std::vector<int>& nodes);
+
+  // cycle lists nodes of d visited in that order and back to the first. Cut
+  // it open into a path and append it to tour, to be driven after node `from`
+  // and before node `to`, choosing the cut (and, when d is symmetric, the
+  // direction) that makes the detour cheapest.
+void appendOpenedCycle(const DistanceMatrix& d, const std::vector<int>& cycle, int from, int to,
+                       std::vector<int>& tour);
+
+#endif // CLUSTERING_INCLUDED
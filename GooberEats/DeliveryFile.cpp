@@ -0,0 +1,224 @@
+#include "DeliveryFile.h"
+#include <iostream>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+bool loadDeliveryRequests(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v)
+{
+    MappedDeliveries file;
+    if (!file.open(deliveriesFile))
+        return false;
+    const vector<DeliveryLineError>& errors = file.errors();
+    for (int i = 0; i < errors.size(); i++)
+        cout << errors[i].message << " in deliveries file line " << errors[i].line << ": " << errors[i].text << endl;
+    return file.toRequests(depot, v);
+}
+
+bool parseDelivery(string line, string& lat, string& lon, string& item)
+{
+    const size_t colon = line.find(':');
+    if (colon == string::npos)
+    {
+        cout << "Missing colon in deliveries file line: " << line << endl;
+        return false;
+    }
+    istringstream iss(line.substr(0, colon));
+    if (!(iss >> lat >> lon))
+    {
+        cout << "Bad format in deliveries file line: " << line << endl;
+        return false;
+    }
+    item = line.substr(colon + 1);
+    if (item.empty())
+    {
+        cout << "Missing item in deliveries file line: " << line << endl;
+        return false;
+    }
+    return true;
+}
+
+MappedDeliveries::MappedDeliveries()
+ : m_data(nullptr), m_size(0), m_hasDepot(false)
+{
+}
+
+MappedDeliveries::~MappedDeliveries()
+{
+    close();
+}
+
+void MappedDeliveries::close()
+{
+    if (m_data != nullptr && m_size > 0)
+        munmap(const_cast<char*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_hasDepot = false;
+    m_deliveries.clear();
+    m_errors.clear();
+}
+
+bool MappedDeliveries::open(const string& file)
+{
+    close();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size > 0)
+    {
+        void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(mapped);
+    }
+    ::close(fd); // the mapping stays
+    split();
+    return true;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+  // The next whitespace-separated word of [p, end), moving p past it.
+static bool nextWord(const char*& p, const char* end, TextView& word)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    if (p == end)
+        return false;
+    word.data = p;
+    while (p < end && !isSpace(*p))
+        p++;
+    word.size = p - word.data;
+    return true;
+}
+
+  // [-+]d{1,3}(.d+)?
+bool isCoordinate(const TextView& t)
+{
+    const char* p = t.data;
+    const char* end = t.data + t.size;
+    if (p < end && (*p == '-' || *p == '+'))
+        p++;
+    const char* digits = p;
+    while (p < end && *p >= '0' && *p <= '9')
+        p++;
+    if (p == digits || p - digits > 3)
+        return false;
+    if (p < end && *p == '.')
+    {
+        const char* fraction = ++p;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+        if (p == fraction)
+            return false;
+    }
+    return p == end;
+}
+
+void MappedDeliveries::split()
+{
+    const char* p = m_data;
+    const char* end = m_data + m_size;
+    int lineNumber = 0;
+    while (p < end)
+    {
+        const char* start = p;
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end;
+        p = (eol < end ? eol + 1 : end);
+        lineNumber++;
+
+        const char* stop = eol;
+        if (stop > start && stop[-1] == '\r')
+            stop--;
+        const char* q = start;
+        while (q < stop && isSpace(*q))
+            q++;
+        if (q == stop)
+            continue;
+
+        if (!m_hasDepot)
+        {
+              // As before, anything after the depot's coordinates is ignored.
+            TextView lat;
+            TextView lon;
+            if (nextWord(q, stop, lat) && nextWord(q, stop, lon) && isCoordinate(lat) && isCoordinate(lon))
+            {
+                m_hasDepot = true;
+                m_depotLat = lat;
+                m_depotLon = lon;
+            }
+            else
+            {
+                DeliveryLineError error = { lineNumber, "Bad depot", string(start, stop) };
+                m_errors.push_back(error);
+                return; // without a depot, nothing else means anything
+            }
+            continue;
+        }
+
+        const char* colon = static_cast<const char*>(memchr(start, ':', stop - start));
+        DeliveryLine d;
+        d.line = lineNumber;
+        const char* message = nullptr;
+        const char* r = start;
+        TextView extra;
+        if (colon == nullptr)
+            message = "Missing colon";
+        else if (!nextWord(r, colon, d.lat) || !nextWord(r, colon, d.lon) || nextWord(r, colon, extra))
+            message = "Bad format";
+        else if (!isCoordinate(d.lat) || !isCoordinate(d.lon))
+            message = "Bad coordinate";
+        else if (colon + 1 == stop)
+            message = "Missing item";
+        if (message != nullptr)
+        {
+            DeliveryLineError error = { lineNumber, message, string(start, stop) };
+            m_errors.push_back(error);
+            continue;
+        }
+        d.item.data = colon + 1;
+        d.item.size = stop - (colon + 1);
+        m_deliveries.push_back(d);
+    }
+    if (!m_hasDepot)
+    {
+        DeliveryLineError error = { lineNumber, "Missing depot", "" };
+        m_errors.push_back(error);
+    }
+}
+
+bool MappedDeliveries::toRequests(GeoCoord& depot, vector<DeliveryRequest>& v) const
+{
+    if (!m_hasDepot)
+        return false;
+    depot = GeoCoord(m_depotLat.str(), m_depotLon.str());
+    v.reserve(v.size() + m_deliveries.size());
+    for (int i = 0; i < m_deliveries.size(); i++)
+    {
+        const DeliveryLine& d = m_deliveries[i];
+        v.push_back(DeliveryRequest(d.item.str(), GeoCoord(d.lat.str(), d.lon.str())));
+    }
+    return true;
+}
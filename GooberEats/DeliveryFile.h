@@ -0,0 +1,92 @@
+#ifndef DELIVERYFILE_INCLUDED
+#define DELIVERYFILE_INCLUDED
+
+#include "provided.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Reading deliveries files: the depot's "latitude longitude" on the first
+// line, then one "latitude longitude:item" line per delivery.
+
+  // Lines that don't parse are reported on cout and skipped. Returns false if
+  // the file can't be opened or its depot line doesn't parse.
+bool loadDeliveryRequests(std::string deliveriesFile, GeoCoord& depot, std::vector<DeliveryRequest>& v);
+bool parseDelivery(std::string line, std::string& lat, std::string& lon, std::string& item);
+
+  // Some of a MappedDeliveries file's text, in place.
+struct TextView
+{
+    const char* data;
+    size_t size;
+
+    std::string str() const { return std::string(data, size); }
+};
+
+  // Whether t is a plain decimal of at most three integer digits, which is
+  // all a map uses and all GeoCoord can convert without throwing.
+bool isCoordinate(const TextView& t);
+
+inline bool isCoordinate(const std::string& s)
+{
+    TextView t = { s.data(), s.size() };
+    return isCoordinate(t);
+}
+
+struct DeliveryLine
+{
+    int line;                   // numbered from 1
+    TextView lat;
+    TextView lon;
+    TextView item;              // everything after the colon, less any '\r'
+};
+
+struct DeliveryLineError
+{
+    int line;
+    std::string message;        // "Missing colon", "Bad format", ...
+    std::string text;           // the line as it is in the file
+};
+
+  // A deliveries file mapped into memory and split up where it lies: each
+  // line's fields are views of the mapped text, so nothing is copied until
+  // DeliveryRequests are made. Every malformed line is kept as an error, not
+  // just the first. Coordinates must pass isCoordinate(). Blank lines are
+  // skipped.
+class MappedDeliveries
+{
+public:
+    MappedDeliveries();
+    ~MappedDeliveries();
+
+      // Map and split file. Returns false if it can't be opened or mapped.
+    bool open(const std::string& file);
+
+    bool hasDepot() const { return m_hasDepot; }
+    TextView depotLat() const { return m_depotLat; }
+    TextView depotLon() const { return m_depotLon; }
+    const std::vector<DeliveryLine>& deliveries() const { return m_deliveries; }
+    const std::vector<DeliveryLineError>& errors() const { return m_errors; }
+
+      // The depot and deliveries as the planner takes them. Returns false,
+      // changing nothing, if there is no depot.
+    bool toRequests(GeoCoord& depot, std::vector<DeliveryRequest>& v) const;
+
+      // We prevent a MappedDeliveries object from being copied or assigned.
+    MappedDeliveries(const MappedDeliveries&) = delete;
+    MappedDeliveries& operator=(const MappedDeliveries&) = delete;
+
+private:
+    const char* m_data;         // nullptr if nothing is mapped
+    size_t m_size;
+    bool m_hasDepot;
+    TextView m_depotLat;
+    TextView m_depotLon;
+    std::vector<DeliveryLine> m_deliveries;
+    std::vector<DeliveryLineError> m_errors;
+
+    void close();
+    void split();
+};
+
+#endif // DELIVERYFILE_INCLUDED
@@ -3,23 +3,87 @@
 using namespace std;
 
 #include <random>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "DistanceMatrix.h"
+#include "HeldKarp.h"
+#include "LocalSearch.h"
+#include "TourMoves.h"
+#include "OptimizerOptions.h"
+#include "RoadMatrix.h"
+#include "Clustering.h"
+#include "PlanStats.h"
+#include "Trace.h"
+
+// Without an iteration cap, the run is as long as cooling from the start to
+// the final temperature at this rate, one step per movesPerDelivery * n moves.
+const double COOLING_RATE = 0.99;
+
+// How many moves go by between looks at the clock and temperature updates.
+const int SCHEDULE_INTERVAL = 256;
+
+// Parallel tempering replicas try at least this many moves between exchanges.
+const int MIN_EXCHANGE_INTERVAL = 2048;
+
+// With a deadline, clustered search leaves this fraction of the time for
+// touring the clusters and the rest for joining and repairing.
+const double CLUSTER_TIME_SHARE = 0.9;
+
+typedef std::mt19937_64 RandomEngine;
+
+  // One annealing walk: where it is, the best tour it has seen, and the random
+  // stream driving it. Chains share nothing, so each can run on its own thread.
+struct AnnealingChain
+{
+    AnnealingChain(const DistanceMatrix& d, const vector<int>& start, unsigned long long seed)
+     : tour(start), length(tourLength(d, start)), bestTour(start), bestLength(length), rng(seed), moves(0), accepted(0)
+    {}
+    vector<int> tour;
+    double length;
+    vector<int> bestTour;
+    double bestLength;
+    RandomEngine rng;
+    long long moves;
+    long long accepted;
+};
 
 class DeliveryOptimizerImpl
 {
 public:
-    DeliveryOptimizerImpl(const StreetMap* sm);
+    DeliveryOptimizerImpl(const StreetMap* sm, const OptimizerOptions& options);
     ~DeliveryOptimizerImpl();
     void optimizeDeliveryOrder(
         const GeoCoord& depot,
         vector<DeliveryRequest>& deliveries,
         double& oldCrowDistance,
-        double& newCrowDistance) const;
+        double& newCrowDistance,
+        OptimizerStats* stats = nullptr) const;
+    long long optimizeTour(const DistanceMatrix& d, vector<int>& tour, OptimizerStats* stats = nullptr) const;
+    const OptimizerOptions& options() const { return m_options; }
+    void setOptions(const OptimizerOptions& options) { m_options = options; }
 private:
-    double generateRand() const;
-    int randInt(int min, int max) const;
+    const StreetMap* m_map;
+    OptimizerOptions m_options;
+    double generateRand(RandomEngine& rng) const;
+    int randInt(RandomEngine& rng, int min, int max) const;
+    double initialTemperature() const;
+    long long iterationBudget(int n) const;
+    double budgetSeconds(chrono::steady_clock::time_point startTime) const;
+    void tryMove(const DistanceMatrix& d, AnnealingChain& chain, double temperature) const;
+    void anneal(const DistanceMatrix& d, AnnealingChain& chain) const;
+    void multiStart(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const;
+    void parallelTempering(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const;
+    void clusteredSearch(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const;
+    bool usesClusters(int n) const;
+    void searchTour(const DistanceMatrix& d, vector<int>& tour, OptimizerStats& tally) const;
 };
 
-DeliveryOptimizerImpl::DeliveryOptimizerImpl(const StreetMap* sm)
+DeliveryOptimizerImpl::DeliveryOptimizerImpl(const StreetMap* sm, const OptimizerOptions& options)
+ : m_map(sm), m_options(options)
 {
 }
 
@@ -27,101 +91,530 @@ DeliveryOptimizerImpl::~DeliveryOptimizerImpl()
 {
 }
 
-double DeliveryOptimizerImpl::generateRand() const
+  // Uniform in [0, 1). Done by hand rather than with <random>'s distributions,
+  // whose output is implementation-defined, so seeded runs repeat exactly.
+double DeliveryOptimizerImpl::generateRand(RandomEngine& rng) const
 {
-    static std::random_device rd;
-    static std::default_random_engine generator(rd());
-    std::uniform_real_distribution<double> distro(0, 1);
-    return distro(generator);
+    return (rng() >> 11) * (1.0 / 9007199254740992.0);
 }
 
-int DeliveryOptimizerImpl::randInt(int min, int max) const
+  // Uniform in [min, max].
+int DeliveryOptimizerImpl::randInt(RandomEngine& rng, int min, int max) const
 {
     if (max < min)
         std::swap(max, min);
-    static std::random_device rd;
-    static std::default_random_engine generator(rd());
-    std::uniform_int_distribution<> distro(min, max);
-    return distro(generator);
+    unsigned long long range = static_cast<unsigned long long>(max - min) + 1;
+    return min + static_cast<int>(((rng() >> 32) * range) >> 32);
 }
 
-void DeliveryOptimizerImpl::optimizeDeliveryOrder(
-    const GeoCoord& depot,
-    vector<DeliveryRequest>& deliveries,
-    double& oldCrowDistance,
-    double& newCrowDistance) const
+  // Seed for the k-th of several chains started from one seed.
+static unsigned long long chainSeed(unsigned long long seed, int k)
+{
+    return seed ^ (0x9E3779B97F4A7C15ULL * (k + 1));
+}
+
+//******************** Simulated annealing ************************************
+
+  // Where annealing starts: cooler when warm-started from a previous order.
+double DeliveryOptimizerImpl::initialTemperature() const
+{
+    if (!m_options.orderHint.empty())
+        return min(m_options.startTemperature, m_options.warmStartTemperature);
+    return m_options.startTemperature;
+}
+
+  // Moves each chain may try: the iteration cap, or by default the length of
+  // the cooling schedule.
+long long DeliveryOptimizerImpl::iterationBudget(int n) const
 {
-    int count = 0;
-    
-    vector<DeliveryRequest> newDeliveries = deliveries;
-    
-    // get oldCrowDistance
-    oldCrowDistance = distanceEarthMiles(depot, deliveries[0].location);
-    for (int i = 0; i < deliveries.size() - 1; i++)
+    if (m_options.maxIterations > 0)
+        return m_options.maxIterations;
+    double startTemperature = initialTemperature();
+    double finalTemperature = min(m_options.finalTemperature, startTemperature);
+    double coolingSteps = ceil(log(finalTemperature / startTemperature) / log(COOLING_RATE));
+    return static_cast<long long>(max(coolingSteps, 1.0)) * max(m_options.movesPerDelivery, 1) * n;
+}
+
+  // Seconds from startTime until the deadline, or 0 if there's no deadline.
+double DeliveryOptimizerImpl::budgetSeconds(chrono::steady_clock::time_point startTime) const
+{
+    if (!m_options.hasDeadline())
+        return 0;
+    return chrono::duration<double>(m_options.deadline - startTime).count();
+}
+
+  // Propose one random move and apply it if the Metropolis test accepts it
+  // at this temperature.
+void DeliveryOptimizerImpl::tryMove(const DistanceMatrix& d, AnnealingChain& chain, double temperature) const
+{
+    vector<int>& tour = chain.tour;
+    RandomEngine& rng = chain.rng;
+    int n = static_cast<int>(tour.size());
+    chain.moves++;
+
+    int moveType = randInt(rng, 0, n >= 3 ? 2 : 0);
+    int i = randInt(rng, 0, n - 1);
+    int j = randInt(rng, 0, n - 1);
+    int len = 0;
+    double costDiff;
+
+    if (moveType == 2)
     {
-        oldCrowDistance += distanceEarthMiles(deliveries[i].location, deliveries[i+1].location);
+          // Or-opt: relocate a run of up to three stops.
+        len = randInt(rng, 1, min(3, n - 1));
+        i = randInt(rng, 0, n - len);
+        do
+        {
+            j = randInt(rng, -1, n - 1);
+        } while (j >= i - 1 && j <= i + len - 1);
+        costDiff = relocateDelta(d, tour, i, len, j);
     }
-    oldCrowDistance += distanceEarthMiles(deliveries[deliveries.size() - 1].location, depot);
-    
-    double temperature = 100;
-    double coolingRate = 0.99; // this is kind of arbitrary... oh well
-    double absoluteTemperature = 0.01;
-    double currentPathCrowDistance = oldCrowDistance;
-    
-    while (temperature > absoluteTemperature)
-    {
-        vector<DeliveryRequest> tentativeNewDeliveries = newDeliveries;
-        
-        int rand1 = randInt(0, deliveries.size()-1);
-        int rand2 = randInt(0, deliveries.size()-1);
-        while (rand2 == rand1)
+    else
+    {
+        while (j == i)
+            j = randInt(rng, 0, n - 1);
+        if (i > j)
+            std::swap(i, j);
+        if (moveType == 1 && !d.symmetric())
+            moveType = 0;
+        costDiff = (moveType == 0 ? swapDelta(d, tour, i, j) : reverseDelta(d, tour, i, j));
+    }
+
+    if (costDiff >= 0)
+    {
+        double probability = exp((-1 * costDiff) / temperature);
+        double random = generateRand(rng);
+        if (probability <= random)
+            return;
+    }
+
+    if (moveType == 0)
+        std::swap(tour[i], tour[j]);
+    else if (moveType == 1)
+        reverse(tour.begin() + i, tour.begin() + j + 1);
+    else
+        relocate(tour, i, len, j);
+    chain.length += costDiff;
+    chain.accepted++;
+
+    if (chain.length < chain.bestLength)
+    {
+        chain.bestLength = chain.length;
+        chain.bestTour = tour;
+    }
+}
+
+  // Run one chain through the cooling schedule. The temperature falls
+  // geometrically with progress through the run, measured against both the
+  // iteration cap and the deadline, so the schedule fits whatever budget the
+  // caller gave. chain.bestTour holds the result.
+void DeliveryOptimizerImpl::anneal(const DistanceMatrix& d, AnnealingChain& chain) const
+{
+    int n = static_cast<int>(chain.tour.size());
+    if (n < 2)
+        return;
+
+    double startTemperature = initialTemperature();
+    double finalTemperature = min(m_options.finalTemperature, startTemperature);
+    long long maxIterations = iterationBudget(n);
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    double budget = budgetSeconds(startTime);
+    double temperature = startTemperature;
+
+    for (long long count = 0; count < maxIterations; count++)
+    {
+        if (count % SCHEDULE_INTERVAL == 0)
         {
-            rand2 = randInt(0, deliveries.size()-1);
+            double progress = static_cast<double>(count) / maxIterations;
+            if (m_options.hasDeadline())
+            {
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+                if (elapsed >= budget)
+                    break;
+                progress = max(progress, elapsed / budget);
+            }
+            temperature = startTemperature * pow(finalTemperature / startTemperature, progress);
         }
-        
-        // reverse segment
-        DeliveryRequest temp = tentativeNewDeliveries[rand1];
-        tentativeNewDeliveries[rand1] = tentativeNewDeliveries[rand2];
-        tentativeNewDeliveries[rand2] = temp;
-        
-        // get tentativeNewCrowDistance w/ reversed segments
-        double tentativeNewCrowDistance = distanceEarthMiles(depot, tentativeNewDeliveries[0].location);
-        for (int i = 0; i < tentativeNewDeliveries.size() - 1; i++)
+        tryMove(d, chain, temperature);
+    }
+}
+
+//******************** Parallel search ****************************************
+
+  // Independently seeded chains, one per thread, all cooling on the same
+  // schedule over the shared (read-only) matrix. Keeps the best result.
+void DeliveryOptimizerImpl::multiStart(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const
+{
+    int chains = max(m_options.threads, 1);
+    vector<AnnealingChain> chain;
+    chain.reserve(chains);
+    for (int k = 0; k < chains; k++)
+        chain.push_back(AnnealingChain(d, tour, chainSeed(seed, k)));
+
+    vector<thread> workers;
+    for (int k = 1; k < chains; k++)
+        workers.push_back(thread(&DeliveryOptimizerImpl::anneal, this, std::cref(d), std::ref(chain[k])));
+    anneal(d, chain[0]);
+    for (int k = 0; k < workers.size(); k++)
+        workers[k].join();
+
+    int best = 0;
+    for (int k = 0; k < chains; k++)
+    {
+        tally.annealingMoves += chain[k].moves;
+        tally.annealingAccepted += chain[k].accepted;
+        if (chain[k].bestLength < chain[best].bestLength)
+            best = k;
+    }
+    tour = chain[best].bestTour;
+}
+
+namespace
+{
+      // Lets a fixed set of threads wait for each other between rounds.
+    class Barrier
+    {
+    public:
+        Barrier(int count) : m_count(count), m_waiting(0), m_generation(0) {}
+        void wait()
         {
-            tentativeNewCrowDistance += distanceEarthMiles(tentativeNewDeliveries[i].location, tentativeNewDeliveries[i+1].location);
+            unique_lock<mutex> lock(m_mutex);
+            int generation = m_generation;
+            if (++m_waiting == m_count)
+            {
+                m_waiting = 0;
+                m_generation++;
+                m_cv.notify_all();
+                return;
+            }
+            m_cv.wait(lock, [&] { return generation != m_generation; });
         }
-        tentativeNewCrowDistance += distanceEarthMiles(tentativeNewDeliveries[newDeliveries.size() - 1].location, depot);
-        
-        double costDiff = tentativeNewCrowDistance - currentPathCrowDistance;
-        if (costDiff < 0)
+    private:
+        mutex m_mutex;
+        condition_variable m_cv;
+        int m_count;
+        int m_waiting;
+        int m_generation;
+    };
+}
+
+  // A ladder of replicas held at fixed temperatures, geometrically spaced
+  // between the final and start temperatures, one per thread. After every
+  // round of moves, neighboring replicas swap tours with the usual
+  // replica-exchange probability, so good tours drift down to the cold end
+  // while the hot end keeps exploring.
+void DeliveryOptimizerImpl::parallelTempering(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const
+{
+    int n = static_cast<int>(tour.size());
+    int replicas = max(m_options.threads, 2);
+    double startTemperature = initialTemperature();
+    double finalTemperature = min(m_options.finalTemperature, startTemperature);
+
+    vector<AnnealingChain> chain;
+    vector<double> temperature(replicas);
+    chain.reserve(replicas);
+    for (int k = 0; k < replicas; k++)
+    {
+        chain.push_back(AnnealingChain(d, tour, chainSeed(seed, k)));
+        temperature[k] = finalTemperature * pow(startTemperature / finalTemperature, static_cast<double>(k) / (replicas - 1));
+    }
+
+    long long maxIterations = iterationBudget(n);
+    long long interval = max(static_cast<long long>(max(m_options.movesPerDelivery, 1)) * n, static_cast<long long>(MIN_EXCHANGE_INTERVAL));
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    double budget = budgetSeconds(startTime);
+    RandomEngine exchangeRng(chainSeed(seed, replicas));
+    long long done = 0;
+    bool finished = (n < 2);
+    Barrier barrier(replicas);
+
+    auto worker = [&](int k)
+    {
+        while (true)
         {
-            newDeliveries = tentativeNewDeliveries;
-            currentPathCrowDistance = tentativeNewCrowDistance;
+            barrier.wait(); // replica 0 has set `finished` for this round
+            if (finished)
+                return;
+            long long moves = min(interval, maxIterations - done);
+            for (long long m = 0; m < moves; m++)
+                tryMove(d, chain[k], temperature[k]);
+            barrier.wait();
+
+            if (k == 0)
+            {
+                  // Exchange between neighbors, alternating even and odd pairs.
+                for (int r = static_cast<int>((done / interval) % 2); r + 1 < replicas; r += 2)
+                {
+                    double delta = (1 / temperature[r] - 1 / temperature[r + 1]) * (chain[r].length - chain[r + 1].length);
+                    if (delta >= 0 || generateRand(exchangeRng) < exp(delta))
+                    {
+                        chain[r].tour.swap(chain[r + 1].tour);
+                        std::swap(chain[r].length, chain[r + 1].length);
+                    }
+                }
+                done += moves;
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+                finished = (done >= maxIterations || (m_options.hasDeadline() && elapsed >= budget));
+            }
         }
-        else
+    };
+
+    vector<thread> workers;
+    for (int k = 1; k < replicas; k++)
+        workers.push_back(thread(worker, k));
+    worker(0);
+    for (int k = 0; k < workers.size(); k++)
+        workers[k].join();
+
+    int best = 0;
+    for (int k = 0; k < replicas; k++)
+    {
+        tally.annealingMoves += chain[k].moves;
+        tally.annealingAccepted += chain[k].accepted;
+        if (chain[k].bestLength < chain[best].bestLength)
+            best = k;
+    }
+    tour = chain[best].bestTour;
+}
+
+//******************** Clustered search ***************************************
+
+  // Split the stops into clusters of about clusterSize, tour each cluster as a
+  // closed loop through its own members, order the clusters by a tour of the
+  // depot and their medoids, then cut each loop open where it best joins its
+  // neighbors in that order. The joins are where this loses to searching the
+  // whole batch, so a final local search pass over the full tour repairs them.
+void DeliveryOptimizerImpl::clusteredSearch(const DistanceMatrix& d, vector<int>& tour, unsigned long long seed, OptimizerStats& tally) const
+{
+    int n = static_cast<int>(tour.size());
+    vector<vector<int> > clusters = clusterStops(d, (n + m_options.clusterSize - 1) / m_options.clusterSize, seed);
+    int k = static_cast<int>(clusters.size());
+
+      // List each cluster's members (after its medoid) in the order the
+      // starting tour visits them, so a warm start carries into the clusters.
+    vector<int> position(n + 1);
+    for (int i = 0; i < n; i++)
+        position[tour[i]] = i;
+    for (int c = 0; c < k; c++)
+        sort(clusters[c].begin() + 1, clusters[c].end(),
+             [&position](int a, int b) { return position[a] < position[b]; });
+    int workers = max(1, min(m_options.threads, k));
+
+    OptimizerOptions sub = m_options;
+    sub.clusterSize = 0;
+    sub.threads = 1;
+    sub.parallelMode = MULTI_START;
+    sub.useSeed = true;
+    sub.startTemperature = initialTemperature();
+    sub.orderHint.clear();
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    chrono::steady_clock::time_point clustersDone = m_options.deadline;
+    if (m_options.hasDeadline() && m_options.deadline > now)
+        clustersDone = now + chrono::duration_cast<chrono::steady_clock::duration>((m_options.deadline - now) * CLUSTER_TIME_SHARE);
+
+      // Workers take clusters in turn. With a deadline, each cluster gets its
+      // share of the time left, by size, so early clusters can't starve late ones.
+    vector<vector<int> > cycles(k);
+    vector<OptimizerStats> clusterTally(k);
+    int nextCluster = 0;
+    int stopsLeft = n;
+    mutex queueMutex;
+    auto worker = [&]()
+    {
+        while (true)
         {
-            double probability = exp((-1 * costDiff) / temperature);
-            double random = generateRand();
-            if (probability > random)
+            OptimizerOptions options = sub;
+            int c;
             {
-                newDeliveries = tentativeNewDeliveries;
-                currentPathCrowDistance = tentativeNewCrowDistance;
+                lock_guard<mutex> lock(queueMutex);
+                if (nextCluster == k)
+                    return;
+                c = nextCluster++;
+                int size = static_cast<int>(clusters[c].size());
+                if (m_options.hasDeadline())
+                {
+                    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                    double share = min(1.0, static_cast<double>(size) * workers / stopsLeft);
+                    options.deadline = (clustersDone > start ?
+                        start + chrono::duration_cast<chrono::steady_clock::duration>((clustersDone - start) * share) : start);
+                }
+                stopsLeft -= size;
             }
+            options.seed = chainSeed(seed, c + 1);
+
+            DeliveryOptimizerImpl optimizer(m_map, options);
+            DistanceMatrix local = subMatrix(d, clusters[c]);
+            vector<int> localTour = identityTour(static_cast<int>(clusters[c].size()) - 1);
+            optimizer.searchTour(local, localTour, clusterTally[c]);
+            cycles[c].push_back(clusters[c][0]);
+            for (int i = 0; i < localTour.size(); i++)
+                cycles[c].push_back(clusters[c][localTour[i]]);
+        }
+    };
+
+    vector<thread> threads;
+    for (int w = 1; w < workers; w++)
+        threads.push_back(thread(worker));
+    worker();
+    for (int w = 0; w < threads.size(); w++)
+        threads[w].join();
+
+    for (int c = 0; c < k; c++)
+        tally.add(clusterTally[c]);
+
+    vector<int> hubs(1, 0);
+    for (int c = 0; c < k; c++)
+        hubs.push_back(clusters[c][0]);
+    vector<int> order = identityTour(k);
+    OptimizerOptions orderOptions = sub;
+    orderOptions.startTemperature = m_options.startTemperature;
+    orderOptions.seed = seed;
+    DeliveryOptimizerImpl(m_map, orderOptions).searchTour(subMatrix(d, hubs), order, tally);
+
+    tour.clear();
+    int from = 0;
+    for (int t = 0; t < k; t++)
+    {
+        int c = order[t] - 1;
+        int to = (t + 1 < k ? clusters[order[t + 1] - 1][0] : 0);
+        appendOpenedCycle(d, cycles[c], from, to, tour);
+        from = tour.back();
+    }
+
+    tally.localSearchMoves += improveTour(d, tour, m_options.neighborCount, m_options.deadline);
+}
+
+  // True if searchTour splits n stops into clusters.
+bool DeliveryOptimizerImpl::usesClusters(int n) const
+{
+    return n > min(m_options.exactThreshold, HELD_KARP_MAX_STOPS) &&
+           m_options.clusterSize > 0 && n > 2 * m_options.clusterSize;
+}
+
+  // Shorten tour by whichever search the options call for, adding the moves
+  // made to tally.
+void DeliveryOptimizerImpl::searchTour(const DistanceMatrix& d, vector<int>& tour, OptimizerStats& tally) const
+{
+    int n = static_cast<int>(tour.size());
+    if (n == 0)
+        return;
+
+    unsigned long long seed = (m_options.useSeed ? m_options.seed : random_device()());
+    if (n <= min(m_options.exactThreshold, HELD_KARP_MAX_STOPS))
+        tour = solveHeldKarp(d);
+    else if (usesClusters(n))
+        clusteredSearch(d, tour, seed, tally);
+    else
+    {
+        if (m_options.strategy == LOCAL_SEARCH)
+        {
+            vector<int> greedy = nearestNeighborTour(d);
+            if (tourLength(d, greedy) < tourLength(d, tour))
+                tour = greedy;
         }
-        
-        temperature *= coolingRate;
-        count++;
+        else if (m_options.parallelMode == PARALLEL_TEMPERING)
+            parallelTempering(d, tour, seed, tally);
+        else if (m_options.threads > 1)
+            multiStart(d, tour, seed, tally);
+        else
+        {
+            AnnealingChain chain(d, tour, seed);
+            anneal(d, chain);
+            tour = chain.bestTour;
+            tally.annealingMoves += chain.moves;
+            tally.annealingAccepted += chain.accepted;
+        }
+
+        if (m_options.strategy != ANNEALING)
+            tally.localSearchMoves += improveTour(d, tour, m_options.neighborCount, m_options.deadline);
+    }
+}
+
+long long DeliveryOptimizerImpl::optimizeTour(const DistanceMatrix& d, vector<int>& tour, OptimizerStats* stats) const
+{
+    TraceSpan span("optimize tour");
+    span.arg("stops", static_cast<long long>(tour.size()));
+    OptimizerStats tally;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    searchTour(d, tour, tally);
+    if (stats != nullptr)
+    {
+        tally.runs = 1;
+        tally.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats->add(tally);
+    }
+    span.arg("moves", tally.annealingMoves + tally.localSearchMoves);
+    return tally.annealingMoves + tally.localSearchMoves;
+}
+
+  // Great-circle length of the tour depot -> deliveries[tour[0] - 1] -> ... -> depot.
+static double crowTourLength(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries, const vector<int>& tour)
+{
+    if (tour.empty())
+        return 0;
+    double length = distanceEarthMiles(depot, deliveries[tour[0] - 1].location);
+    for (int i = 0; i + 1 < tour.size(); i++)
+        length += distanceEarthMiles(deliveries[tour[i] - 1].location, deliveries[tour[i+1] - 1].location);
+    length += distanceEarthMiles(deliveries[tour.back() - 1].location, depot);
+    return length;
+}
+
+void DeliveryOptimizerImpl::optimizeDeliveryOrder(
+    const GeoCoord& depot,
+    vector<DeliveryRequest>& deliveries,
+    double& oldCrowDistance,
+    double& newCrowDistance,
+    OptimizerStats* stats) const
+{
+    TraceSpan span("optimize");
+    span.arg("stops", static_cast<long long>(deliveries.size()));
+    if (deliveries.empty())
+    {
+        oldCrowDistance = newCrowDistance = 0;
+        return;
     }
-    
-    newCrowDistance = distanceEarthMiles(depot, newDeliveries[0].location);
-    for (int i = 0; i < newDeliveries.size() - 1; i++)
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+      // A clustered search is a heuristic from its first split on, so it can
+      // order stops by the cheaper flat-earth miles; the crow miles reported
+      // are still great-circle ones.
+    int n = static_cast<int>(deliveries.size());
+    bool flat = usesClusters(n);
+    DistanceMatrix crow;
+    crow.buildCrowFlies(depot, deliveries, (flat ? EQUIRECTANGULAR : HAVERSINE));
+
+    vector<int> tour = identityTour(n);
+    oldCrowDistance = (flat ? crowTourLength(depot, deliveries, tour) : tourLength(crow, tour));
+
+      // If some stop is off the map or cut off, road distances are undefined;
+      // order by crow-flies and leave reporting that to whoever routes it.
+    RoadMatrix road(m_map);
+    const DistanceMatrix* d = &crow;
+    if (m_options.metric == ROAD_DISTANCE && road.build(depot, deliveries) == DELIVERY_SUCCESS)
+        d = &road.distances();
+    if (!m_options.orderHint.empty())
+        tour = warmStartTour(*d, deliveries, m_options.orderHint);
+    OptimizerStats tally;
+    searchTour(*d, tour, tally);
+    newCrowDistance = (flat ? crowTourLength(depot, deliveries, tour) : tourLength(crow, tour));
+    span.arg("road", static_cast<long long>(d != &crow));
+    span.arg("moves", tally.annealingMoves + tally.localSearchMoves);
+    span.arg("crow miles", newCrowDistance);
+    if (stats != nullptr)
     {
-        newCrowDistance += distanceEarthMiles(newDeliveries[i].location, newDeliveries[i+1].location);
+        tally.runs = 1;
+        tally.oldCrowMiles = oldCrowDistance;
+        tally.newCrowMiles = newCrowDistance;
+        tally.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats->add(tally);
     }
-    cerr << "oldCrowDistance: " << oldCrowDistance << endl;
-    cerr << "newCrowDistance: " << newCrowDistance << endl;
-    cerr << "count: " << count << endl;
-    deliveries = newDeliveries;
+
+    vector<DeliveryRequest> newDeliveries;
+    newDeliveries.reserve(deliveries.size());
+    for (int i = 0; i < tour.size(); i++)
+        newDeliveries.push_back(deliveries[tour[i] - 1]);
+    deliveries.swap(newDeliveries);
 }
 
 //******************** DeliveryOptimizer functions ****************************
@@ -131,7 +624,7 @@ void DeliveryOptimizerImpl::optimizeDeliveryOrder(
 
 DeliveryOptimizer::DeliveryOptimizer(const StreetMap* sm)
 {
-    m_impl = new DeliveryOptimizerImpl(sm);
+    m_impl = new DeliveryOptimizerImpl(sm, OptimizerOptions());
 }
 
 DeliveryOptimizer::~DeliveryOptimizer()
@@ -147,3 +640,40 @@ void DeliveryOptimizer::optimizeDeliveryOrder(
 {
     return m_impl->optimizeDeliveryOrder(depot, deliveries, oldCrowDistance, newCrowDistance);
 }
+
+//******************** ConfigurableDeliveryOptimizer functions ****************
+
+ConfigurableDeliveryOptimizer::ConfigurableDeliveryOptimizer(const StreetMap* sm, const OptimizerOptions& options)
+{
+    m_impl = new DeliveryOptimizerImpl(sm, options);
+}
+
+ConfigurableDeliveryOptimizer::~ConfigurableDeliveryOptimizer()
+{
+    delete m_impl;
+}
+
+void ConfigurableDeliveryOptimizer::optimizeDeliveryOrder(
+        const GeoCoord& depot,
+        vector<DeliveryRequest>& deliveries,
+        double& oldCrowDistance,
+        double& newCrowDistance,
+        OptimizerStats* stats) const
+{
+    return m_impl->optimizeDeliveryOrder(depot, deliveries, oldCrowDistance, newCrowDistance, stats);
+}
+
+long long ConfigurableDeliveryOptimizer::optimizeTour(const DistanceMatrix& d, vector<int>& tour, OptimizerStats* stats) const
+{
+    return m_impl->optimizeTour(d, tour, stats);
+}
+
+const OptimizerOptions& ConfigurableDeliveryOptimizer::options() const
+{
+    return m_impl->options();
+}
+
+void ConfigurableDeliveryOptimizer::setOptions(const OptimizerOptions& options)
+{
+    m_impl->setOptions(options);
+}
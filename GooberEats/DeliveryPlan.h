@@ -0,0 +1,39 @@
+#ifndef DELIVERYPLAN_INCLUDED
+#define DELIVERYPLAN_INCLUDED
+
+#include "provided.h"
+#include <vector>
+
+// A delivery plan kept leg by leg, so it can be changed one leg at a time
+// (see ConfigurableDeliveryPlanner::insertDeliveries) instead of being planned
+// again from scratch.
+
+struct DeliveryPlan
+{
+    GeoCoord depot;
+
+      // The deliveries, in the order they are made.
+    std::vector<DeliveryRequest> stops;
+
+      // legs[i] drives to stops[i] and ends with its Deliver command; the last
+      // leg drives back to the depot. legMiles[i] is how far legs[i] drives.
+    std::vector<std::vector<DeliveryCommand> > legs;
+    std::vector<double> legMiles;
+
+      // Append every leg's commands to commands, in order.
+    void appendCommands(std::vector<DeliveryCommand>& commands) const
+    {
+        for (size_t i = 0; i < legs.size(); i++)
+            commands.insert(commands.end(), legs[i].begin(), legs[i].end());
+    }
+
+    double totalDistance() const
+    {
+        double miles = 0;
+        for (size_t i = 0; i < legMiles.size(); i++)
+            miles += legMiles[i];
+        return miles;
+    }
+};
+
+#endif // DELIVERYPLAN_INCLUDED
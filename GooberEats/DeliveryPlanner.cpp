@@ -2,67 +2,152 @@
 #include <vector>
 using namespace std;
 
+#include "PlannerOptions.h"
+#include "RoadMatrix.h"
+#include "WorkerPool.h"
+#include "PlanCommand.h"
+#include "LegCompiler.h"
+#include "PlanStats.h"
+#include "Trace.h"
+#include <mutex>
+#include <chrono>
+#include <cassert>
 
-const int NO_TURN = 0;
-const int LEFT_TURN = 1;
-const int RIGHT_TURN = 2;
 
 class DeliveryPlannerImpl
 {
 public:
-    DeliveryPlannerImpl(const StreetMap* sm);
+    DeliveryPlannerImpl(const StreetMap* sm, const PlannerOptions& options);
     ~DeliveryPlannerImpl();
     DeliveryResult generateDeliveryPlan(
         const GeoCoord& depot,
         const vector<DeliveryRequest>& deliveries,
         vector<DeliveryCommand>& commands,
-        double& totalDistanceTravelled) const;
+        double& totalDistanceTravelled,
+        PlanStats* stats = nullptr) const;
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        DeliveryPlan& plan,
+        PlanStats* stats = nullptr) const;
+    DeliveryResult insertDeliveries(DeliveryPlan& plan, const vector<DeliveryRequest>& newDeliveries) const;
+    DeliveryResult streamDeliveryPlan(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        NameTable& names,
+        const LegCallback& onLeg,
+        PlanStats* stats = nullptr,
+        vector<DeliveryRequest>* order = nullptr) const;
+    const PlannerOptions& options() const { return m_options; }
+    void setOptions(const PlannerOptions& options);
 private:
     const StreetMap* m_map;
-    string getDirectionForProceedCmd(double angle) const;
-    int getDirectionForTurnCmd(double angle) const;
+    PlannerOptions m_options;
+    WorkerPool* m_pool;             // nullptr unless routingThreads > 1
+    DeliveryResult planLegs(
+        const GeoCoord& depot,
+        const vector<DeliveryRequest>& deliveries,
+        NameTable& names,
+        const LegCallback& onLeg,
+        PlanStats* stats,
+        vector<DeliveryRequest>* order) const;
 };
 
-DeliveryPlannerImpl::DeliveryPlannerImpl(const StreetMap* sm)
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+DeliveryPlannerImpl::DeliveryPlannerImpl(const StreetMap* sm, const PlannerOptions& options)
+ : m_pool(nullptr)
 {
     m_map = sm;
+    setOptions(options);
 }
 
 DeliveryPlannerImpl::~DeliveryPlannerImpl()
 {
+    delete m_pool;
 }
 
-string DeliveryPlannerImpl::getDirectionForProceedCmd(double angle) const
+void DeliveryPlannerImpl::setOptions(const PlannerOptions& options)
 {
-    if (angle >= 0 && angle < 22.5) { return "east"; }
-    if (angle >= 22.5 && angle < 67.5) { return "northeast"; }
-    if (angle >= 67.5 && angle < 112.5) { return "north"; }
-    if (angle >= 112.5 && angle < 157.5) { return "northwest"; }
-    if (angle >= 157.5 && angle < 202.5) { return "west"; }
-    if (angle >= 202.5 && angle < 247.5) { return "southwest"; }
-    if (angle >= 247.5 && angle < 292.5) { return "south"; }
-    if (angle >= 292.5 && angle < 337.5) { return "southeast"; }
-    else { return "east"; }
+    m_options = options;
+    int threads = (m_options.routingThreads > 1 ? m_options.routingThreads : 0);
+    if (threads != (m_pool != nullptr ? m_pool->size() : 0))
+    {
+        delete m_pool;
+        m_pool = (threads > 0 ? new WorkerPool(threads) : nullptr);
+    }
 }
 
-int DeliveryPlannerImpl::getDirectionForTurnCmd(double angle) const
+DeliveryResult DeliveryPlannerImpl::streamDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    NameTable& names,
+    const LegCallback& onLeg,
+    PlanStats* stats,
+    vector<DeliveryRequest>* order) const
 {
-    if (angle < 1 || angle > 359) return NO_TURN;
-    if (angle >= 1 && angle < 180) return LEFT_TURN;
-    else return RIGHT_TURN;
+    TraceSpan span("plan");
+    span.arg("stops", static_cast<long long>(deliveries.size()));
+    if (stats == nullptr)
+        return planLegs(depot, deliveries, names, onLeg, nullptr, order);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    DeliveryResult result = planLegs(depot, deliveries, names, onLeg, stats, order);
+    stats->totalMilliseconds += millisecondsSince(start);
+    return result;
 }
 
-DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
+  // Order the deliveries, then route each leg and hand its commands to onLeg,
+  // in leg order. If order isn't null, it gets the deliveries in the order
+  // they're made. If stats isn't null, the work is counted into it.
+DeliveryResult DeliveryPlannerImpl::planLegs(
     const GeoCoord& depot,
     const vector<DeliveryRequest>& deliveries,
-    vector<DeliveryCommand>& commands,
-    double& totalDistanceTravelled) const
+    NameTable& names,
+    const LegCallback& onLeg,
+    PlanStats* stats,
+    vector<DeliveryRequest>* order) const
 {
-    DeliveryOptimizer optimize(m_map);
+    chrono::steady_clock::time_point start;
+    if (stats != nullptr)
+        start = chrono::steady_clock::now();
+    RouteStats* routeStats = (stats != nullptr ? &stats->routing : nullptr);
+    OptimizerStats* optimizerStats = (stats != nullptr ? &stats->optimizer : nullptr);
+    ConfigurableDeliveryOptimizer optimize(m_map, m_options.optimizer);
     vector<DeliveryRequest> newDeliveries = deliveries;
-    double oldCrowDistance;
-    double newCrowDistance;
-    optimize.optimizeDeliveryOrder(depot, newDeliveries, oldCrowDistance, newCrowDistance);
+
+      // With road distances, the searches that fill the matrix already hold
+      // every leg's route, so legs come from there instead of the router.
+    RoadMatrix road(m_map);
+    const RoadMatrix* legs = nullptr;
+    vector<int> tour;
+    if (m_options.optimizer.metric == ROAD_DISTANCE)
+    {
+        DeliveryResult result = road.build(depot, deliveries, routeStats);
+        if (result != DELIVERY_SUCCESS)
+            return result;
+        legs = &road;
+        if (m_options.optimizer.orderHint.empty())
+            tour = identityTour(static_cast<int>(deliveries.size()));
+        else
+            tour = warmStartTour(road.distances(), deliveries, m_options.optimizer.orderHint);
+        optimize.optimizeTour(road.distances(), tour, optimizerStats);
+        for (int i = 0; i < tour.size(); i++)
+            newDeliveries[i] = deliveries[tour[i] - 1];
+    }
+    else
+    {
+        double oldCrowDistance;
+        double newCrowDistance;
+        optimize.optimizeDeliveryOrder(depot, newDeliveries, oldCrowDistance, newCrowDistance, optimizerStats);
+    }
+    if (stats != nullptr)
+    {
+        stats->optimizeMilliseconds += millisecondsSince(start);
+        start = chrono::steady_clock::now();
+    }
     
     vector<StreetSegment> segments;
     if (!(m_map->getSegmentsThatStartWith(depot, segments)))
@@ -71,15 +156,6 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
         return BAD_COORD;
     }
     
-    // make deliveries
-    PointToPointRouter router(m_map);
-    const GeoCoord* a = &depot;
-    const GeoCoord* b = nullptr;
-    std::list<StreetSegment> route;
-    double totalDist;
-    
-    totalDistanceTravelled = 0;
-    
     for (int i = 0; i < newDeliveries.size(); i++)
     {
         if (!(m_map->getSegmentsThatStartWith(newDeliveries[i].location, segments)))
@@ -87,129 +163,282 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
             cerr << "Bad coordinate!" << endl;
             return BAD_COORD;
         }
+    }
+    
+    if (order != nullptr)
+        *order = newDeliveries;
+    
+      // Leg i ends at stop i, and leg n ends back at the depot.
+    int n = static_cast<int>(newDeliveries.size());
+    CountingRouter router(m_map);
+    auto buildLeg = [&](int i, vector<PlanCommand>& commands, double& miles, RouteStats* legStats)
+    {
+        TraceSpan legSpan("leg");
+        legSpan.arg("leg", i);
+        legSpan.arg("to", (i == n ? string("depot") : newDeliveries[i].item));
+        list<StreetSegment> route;
+        double totalDist;
+        if (legs != nullptr)
+            legs->route(i == 0 ? 0 : tour[i - 1], i == n ? 0 : tour[i], route, totalDist);
+        else
+        {
+            const GeoCoord& a = (i == 0 ? depot : newDeliveries[i - 1].location);
+            const GeoCoord& b = (i == n ? depot : newDeliveries[i].location);
+            if (router.generatePointToPointRoute(a, b, route, totalDist, legStats) != DELIVERY_SUCCESS)
+                return NO_ROUTE;
+        }
         
-        b = &newDeliveries[i].location;
-        if (router.generatePointToPointRoute(*a, *b, route, totalDist) != DELIVERY_SUCCESS) return NO_ROUTE;
-        
-        double distDownStreet = 0;
-        StreetSegment firstStreetSeg = route.front();
-        StreetSegment prevStreetSeg = route.front();
-        
-        list<StreetSegment>::const_iterator it = route.begin();
-        while (it != route.end())
+        TraceSpan compileSpan("compile");
+        commands.clear();
+        miles = 0;
+        compileLeg(route, names, commands, miles);
+        if (i < n)
         {
-            if (it->name == prevStreetSeg.name)
+            PlanCommand deliver = makePlanCommand(PLAN_DELIVER, DIR_NONE, names.intern(newDeliveries[i].item));
+            commands.push_back(deliver);
+        }
+        compileSpan.arg("commands", static_cast<long long>(commands.size()));
+        legSpan.arg("miles", miles);
+        return DELIVERY_SUCCESS;
+    };
+    
+    if (m_pool == nullptr || legs != nullptr)
+    {
+        vector<PlanCommand> commands;
+        double miles;
+        DeliveryResult result = DELIVERY_SUCCESS;
+        int i = 0;
+        for ( ; i <= n; i++)
+        {
+            if (buildLeg(i, commands, miles, routeStats) != DELIVERY_SUCCESS)
             {
-                distDownStreet += distanceEarthMiles(it->start, it->end);
+                result = NO_ROUTE;
+                break;
             }
-            
-            else
+            onLeg(i, commands, miles);
+        }
+        if (stats != nullptr)
+        {
+            stats->legs += i;
+            stats->legMilliseconds += millisecondsSince(start);
+        }
+        return result;
+    }
+    
+      // On the pool, legs finish out of order. A finished leg waits until
+      // every leg before it has gone out; whichever thread finishes the leg
+      // that's due sends it, and any waiting behind it, under the lock, so
+      // onLeg sees legs in order and one at a time.
+    struct BuiltLeg
+    {
+        BuiltLeg() : done(false), result(DELIVERY_SUCCESS), miles(0) {}
+        bool done;
+        DeliveryResult result;
+        vector<PlanCommand> commands;
+        double miles;
+        RouteStats routing;
+    };
+    vector<BuiltLeg> built(n + 1);
+    int nextLeg = 0;
+    bool failed = false;
+    mutex emitMutex;
+    m_pool->run(n + 1, [&](int i)
+    {
+        {
+            lock_guard<mutex> lock(emitMutex);
+            if (failed)
+                return; // a leg before this one can't be routed
+        }
+        BuiltLeg leg;
+        leg.result = buildLeg(i, leg.commands, leg.miles, (stats != nullptr ? &leg.routing : nullptr));
+        leg.done = true;
+        
+        lock_guard<mutex> lock(emitMutex);
+        if (stats != nullptr)
+            stats->routing.add(leg.routing);
+        built[i] = leg;
+        while (!failed && nextLeg <= n && built[nextLeg].done)
+        {
+            BuiltLeg& next = built[nextLeg];
+            if (next.result != DELIVERY_SUCCESS)
             {
-                DeliveryCommand proceed;
-                double angle = angleOfLine(firstStreetSeg);
-                string dir = getDirectionForProceedCmd(angle);
-                proceed.initAsProceedCommand(dir, firstStreetSeg.name, distDownStreet);
-                commands.push_back(proceed);
-                
-                totalDistanceTravelled += distDownStreet;
-                firstStreetSeg = *it;
-                
-                DeliveryCommand turn;
-                angle = angleBetween2Lines(prevStreetSeg, *it);
-                int dirCmd = getDirectionForTurnCmd(angle);
-                if (dirCmd != NO_TURN)
-                {
-                    if (dirCmd == LEFT_TURN)
-                    {
-                        turn.initAsTurnCommand("left", it->name);
-                    }
-                    if (dirCmd == RIGHT_TURN)
-                    {
-                        turn.initAsTurnCommand("right", it->name);
-                    }
-                    commands.push_back(turn);
-                }
-                distDownStreet = distanceEarthMiles(it->start, it->end);
+                failed = true;
+                break;
             }
-            prevStreetSeg = *it;
-            ++it;
+            onLeg(nextLeg, next.commands, next.miles);
+            vector<PlanCommand>().swap(next.commands);
+            nextLeg++;
         }
-        
-        DeliveryCommand proceedToDelivery;
-        double angle = angleOfLine(firstStreetSeg);
-        string dir = getDirectionForProceedCmd(angle);
-        proceedToDelivery.initAsProceedCommand(dir, firstStreetSeg.name, distDownStreet);
-        commands.push_back(proceedToDelivery);
-        totalDistanceTravelled += distDownStreet;
-        
-        DeliveryCommand deliver;
-        deliver.initAsDeliverCommand(newDeliveries[i].item);
-//        cerr << "Delivered " << deliver.description() << endl;
-        commands.push_back(deliver);
+    });
+    if (stats != nullptr)
+    {
+        stats->legs += nextLeg;
+        stats->legMilliseconds += millisecondsSince(start);
+    }
+    return (failed ? NO_ROUTE : DELIVERY_SUCCESS);
+}
+
+  // Copy a leg's commands out as DeliveryCommands.
+static void appendDeliveryCommands(const vector<PlanCommand>& from, const NameTable& names, vector<DeliveryCommand>& to)
+{
+    to.reserve(to.size() + from.size());
+    for (int i = 0; i < from.size(); i++)
+        to.push_back(from[i].toDeliveryCommand(names));
+}
+
+DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    DeliveryPlan& plan,
+    PlanStats* stats) const
+{
+    NameTable names;
+    DeliveryPlan built;
+    auto keepLeg = [&built, &names](int /*leg*/, const vector<PlanCommand>& commands, double miles)
+    {
+        built.legs.push_back(vector<DeliveryCommand>());
+        appendDeliveryCommands(commands, names, built.legs.back());
+        built.legMiles.push_back(miles);
+    };
+    DeliveryResult result = streamDeliveryPlan(depot, deliveries, names, keepLeg, stats, &built.stops);
+    if (result != DELIVERY_SUCCESS)
+        return result;
+    built.depot = depot;
+    swap(plan, built);
+    return DELIVERY_SUCCESS;
+}
+
+DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    vector<DeliveryCommand>& commands,
+    double& totalDistanceTravelled,
+    PlanStats* stats) const
+{
+    NameTable names;
+    vector<DeliveryCommand> planned;
+    double miles = 0;
+    auto keepLeg = [&planned, &miles, &names](int /*leg*/, const vector<PlanCommand>& legCommands, double legMiles)
+    {
+        appendDeliveryCommands(legCommands, names, planned);
+        miles += legMiles;
+    };
+    DeliveryResult result = streamDeliveryPlan(depot, deliveries, names, keepLeg, stats);
+    if (result != DELIVERY_SUCCESS)
+        return result;
+    commands.insert(commands.end(), planned.begin(), planned.end());
+    totalDistanceTravelled = miles;
+    return DELIVERY_SUCCESS;
+}
+
+  // What one late order's insert replaced, so it can be taken out again.
+struct InsertUndo
+{
+    int position;
+    vector<DeliveryCommand> oldLeg;
+    double oldMiles;
+};
 
-        a = &newDeliveries[i].location;
+  // Take the inserts out of plan again, latest first, leaving it as it was
+  // before the first of them.
+static void undoInserts(DeliveryPlan& plan, vector<InsertUndo>& undo)
+{
+    for (int k = static_cast<int>(undo.size()) - 1; k >= 0; k--)
+    {
+        int p = undo[k].position;
+        plan.stops.erase(plan.stops.begin() + p);
+        plan.legs.erase(plan.legs.begin() + p);
+        plan.legMiles.erase(plan.legMiles.begin() + p);
+        plan.legs[p].swap(undo[k].oldLeg);
+        plan.legMiles[p] = undo[k].oldMiles;
     }
-    
-    // go home
-    std::list<StreetSegment> homeRoute;
-    if (router.generatePointToPointRoute(newDeliveries[newDeliveries.size()-1].location, depot, homeRoute, totalDist) != DELIVERY_SUCCESS) return NO_ROUTE;
-    
-    double distDownStreet = 0;
-    StreetSegment firstStreetSeg = homeRoute.front();
-    StreetSegment prevStreetSeg = homeRoute.front();
-    
-    list<StreetSegment>::const_iterator it = homeRoute.begin();
-    while (it != homeRoute.end())
+}
+
+DeliveryResult DeliveryPlannerImpl::insertDeliveries(DeliveryPlan& plan, const vector<DeliveryRequest>& newDeliveries) const
+{
+    assert(plan.legs.size() == plan.stops.size() + 1 && plan.legMiles.size() == plan.legs.size());
+
+      // Each order goes straight into the plan, keeping only the leg it
+      // replaced, so a later one that fails can be backed out without the
+      // plan ever having been copied.
+    vector<InsertUndo> undo;
+    undo.reserve(newDeliveries.size());
+    PointToPointRouter router(m_map);
+    vector<StreetSegment> segments;
+    for (int k = 0; k < newDeliveries.size(); k++)
     {
-        if (it->name == prevStreetSeg.name)
+        const DeliveryRequest& late = newDeliveries[k];
+        if (!(m_map->getSegmentsThatStartWith(late.location, segments)))
         {
-            distDownStreet += distanceEarthMiles(it->start, it->end);
+            cerr << "Bad coordinate!" << endl;
+            undoInserts(plan, undo);
+            return BAD_COORD;
         }
-        
-        else
+
+          // Going in before stops[p] (or before the depot, for p == n) costs the
+          // detour prev -> late -> next in place of prev -> next.
+        int n = static_cast<int>(plan.stops.size());
+        int best = 0;
+        double bestDetour = 0;
+        for (int p = 0; p <= n; p++)
         {
-            DeliveryCommand d1;
-            double angle = angleOfLine(firstStreetSeg);
-            string dir = getDirectionForProceedCmd(angle);
-            d1.initAsProceedCommand(dir, firstStreetSeg.name, distDownStreet);
-            commands.push_back(d1);
-            
-            firstStreetSeg = *it;
-            totalDistanceTravelled += distDownStreet;
-            
-            DeliveryCommand d2;
-            angle = angleBetween2Lines(*it, prevStreetSeg);
-            int dirCmd = getDirectionForTurnCmd(angle);
-            if (dirCmd != NO_TURN)
+            const GeoCoord& prev = (p == 0 ? plan.depot : plan.stops[p - 1].location);
+            const GeoCoord& next = (p == n ? plan.depot : plan.stops[p].location);
+            double detour = distanceEarthMiles(prev, late.location) + distanceEarthMiles(late.location, next)
+                          - distanceEarthMiles(prev, next);
+            if (p == 0 || detour < bestDetour)
             {
-                if (dirCmd == LEFT_TURN)
-                {
-                    d2.initAsTurnCommand("left", it->name);
-                }
-                if (dirCmd == RIGHT_TURN)
-                {
-                    d2.initAsTurnCommand("right", it->name);
-                }
-                commands.push_back(d2);
+                bestDetour = detour;
+                best = p;
             }
-            distDownStreet = distanceEarthMiles(it->start, it->end);
         }
-        
-        if (*it == homeRoute.back())
+
+        const GeoCoord& prev = (best == 0 ? plan.depot : plan.stops[best - 1].location);
+        const GeoCoord& next = (best == n ? plan.depot : plan.stops[best].location);
+        list<StreetSegment> routeIn;
+        list<StreetSegment> routeOut;
+        double totalDist;
+        if (router.generatePointToPointRoute(prev, late.location, routeIn, totalDist) != DELIVERY_SUCCESS ||
+            router.generatePointToPointRoute(late.location, next, routeOut, totalDist) != DELIVERY_SUCCESS)
         {
-            DeliveryCommand proceedHome;
-            double angle = angleOfLine(firstStreetSeg);
-            string dir = getDirectionForProceedCmd(angle);
-            proceedHome.initAsProceedCommand(dir, firstStreetSeg.name, distDownStreet);
-            commands.push_back(proceedHome);
-            totalDistanceTravelled += distDownStreet;
+            undoInserts(plan, undo);
+            return NO_ROUTE;
         }
-        
-        prevStreetSeg = *it;
-        ++it;
+
+        NameTable names;
+        vector<PlanCommand> commands;
+        vector<DeliveryCommand> legIn;
+        double milesIn = 0;
+        compileLeg(routeIn, names, commands, milesIn);
+        PlanCommand deliver = makePlanCommand(PLAN_DELIVER, DIR_NONE, names.intern(late.item));
+        commands.push_back(deliver);
+        appendDeliveryCommands(commands, names, legIn);
+
+        commands.clear();
+        vector<DeliveryCommand> legOut;
+        double milesOut = 0;
+        compileLeg(routeOut, names, commands, milesOut);
+        if (best < n)
+        {
+            deliver.name = names.intern(plan.stops[best].item);
+            commands.push_back(deliver);
+        }
+        appendDeliveryCommands(commands, names, legOut);
+
+          // The leg that used to run prev -> next becomes late -> next, and the
+          // new leg to late goes in front of it.
+        undo.push_back(InsertUndo());
+        undo.back().position = best;
+        undo.back().oldMiles = plan.legMiles[best];
+        plan.legs[best].swap(undo.back().oldLeg);
+        plan.legs[best].swap(legOut);
+        plan.legMiles[best] = milesOut;
+        plan.legs.insert(plan.legs.begin() + best, vector<DeliveryCommand>());
+        plan.legs[best].swap(legIn);
+        plan.legMiles.insert(plan.legMiles.begin() + best, milesIn);
+        plan.stops.insert(plan.stops.begin() + best, late);
     }
-    
-    return DELIVERY_SUCCESS;  // Delete this line and implement this function correctly
+    return DELIVERY_SUCCESS;
 }
 
 //******************** DeliveryPlanner functions ******************************
@@ -219,7 +448,7 @@ DeliveryResult DeliveryPlannerImpl::generateDeliveryPlan(
 
 DeliveryPlanner::DeliveryPlanner(const StreetMap* sm)
 {
-    m_impl = new DeliveryPlannerImpl(sm);
+    m_impl = new DeliveryPlannerImpl(sm, PlannerOptions());
 }
 
 DeliveryPlanner::~DeliveryPlanner()
@@ -235,3 +464,59 @@ DeliveryResult DeliveryPlanner::generateDeliveryPlan(
 {
     return m_impl->generateDeliveryPlan(depot, deliveries, commands, totalDistanceTravelled);
 }
+
+//******************** ConfigurableDeliveryPlanner functions ******************
+
+ConfigurableDeliveryPlanner::ConfigurableDeliveryPlanner(const StreetMap* sm, const PlannerOptions& options)
+{
+    m_impl = new DeliveryPlannerImpl(sm, options);
+}
+
+ConfigurableDeliveryPlanner::~ConfigurableDeliveryPlanner()
+{
+    delete m_impl;
+}
+
+DeliveryResult ConfigurableDeliveryPlanner::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    vector<DeliveryCommand>& commands,
+    double& totalDistanceTravelled,
+    PlanStats* stats) const
+{
+    return m_impl->generateDeliveryPlan(depot, deliveries, commands, totalDistanceTravelled, stats);
+}
+
+DeliveryResult ConfigurableDeliveryPlanner::generateDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    DeliveryPlan& plan,
+    PlanStats* stats) const
+{
+    return m_impl->generateDeliveryPlan(depot, deliveries, plan, stats);
+}
+
+DeliveryResult ConfigurableDeliveryPlanner::insertDeliveries(DeliveryPlan& plan, const vector<DeliveryRequest>& newDeliveries) const
+{
+    return m_impl->insertDeliveries(plan, newDeliveries);
+}
+
+DeliveryResult ConfigurableDeliveryPlanner::streamDeliveryPlan(
+    const GeoCoord& depot,
+    const vector<DeliveryRequest>& deliveries,
+    NameTable& names,
+    const LegCallback& onLeg,
+    PlanStats* stats) const
+{
+    return m_impl->streamDeliveryPlan(depot, deliveries, names, onLeg, stats);
+}
+
+const PlannerOptions& ConfigurableDeliveryPlanner::options() const
+{
+    return m_impl->options();
+}
+
+void ConfigurableDeliveryPlanner::setOptions(const PlannerOptions& options)
+{
+    m_impl->setOptions(options);
+}
@@ -0,0 +1,274 @@
+#include "DistanceKernel.h"
+#include <cmath>
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOOBER_X86_KERNEL 1
+#include <immintrin.h>
+#else
+#define GOOBER_X86_KERNEL 0
+#endif
+
+namespace
+{
+    const double EARTH_RADIUS_MILES = 6371.0 / 1.609344; // same constants as provided.h
+    const double PI = 3.14159265358979323846;
+
+      // One side of a batch: either an array or a single point repeated.
+    struct PointSpan
+    {
+        const double* lat;
+        const double* lon;
+        const double* cosLat;
+        bool repeated;
+    };
+
+    inline double scalarDistance(double lat1, double lon1, double cos1,
+                                 double lat2, double lon2, double cos2, DistanceMode mode)
+    {
+        if (mode == HAVERSINE)
+        {
+            double u = sin((lat2 - lat1) / 2);
+            double v = sin((lon2 - lon1) / 2);
+            double a = u * u + cos1 * cos2 * v * v;
+            return 2.0 * EARTH_RADIUS_MILES * asin(sqrt(a < 1 ? a : 1));
+        }
+        double dLon = lon2 - lon1;
+        if (dLon > PI) dLon -= 2 * PI;
+        if (dLon < -PI) dLon += 2 * PI;
+        double x = dLon * (cos1 + cos2) / 2;
+        double y = lat2 - lat1;
+        return EARTH_RADIUS_MILES * sqrt(x * x + y * y);
+    }
+
+    void scalarKernel(const PointSpan& a, const PointSpan& b, double* out,
+                      size_t begin, size_t end, DistanceMode mode)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            size_t ia = (a.repeated ? 0 : i);
+            size_t ib = (b.repeated ? 0 : i);
+            out[i] = scalarDistance(a.lat[ia], a.lon[ia], a.cosLat[ia],
+                                    b.lat[ib], b.lon[ib], b.cosLat[ib], mode);
+        }
+    }
+
+#if GOOBER_X86_KERNEL
+      // Taylor coefficients for the polynomial sin, cos and asin below. Terms
+      // are carried far enough that truncation error is under 1e-16 on the
+      // reduced ranges used.
+    const int SIN_TERMS = 7;   // r^3 .. r^15, |r| <= pi/4
+    const int COS_TERMS = 8;   // r^2 .. r^16, |r| <= pi/4
+    const int ASIN_TERMS = 22; // y^3 .. y^45, |y| <= 1/2
+
+    struct PolyCoefficients
+    {
+        double sinC[SIN_TERMS];
+        double cosC[COS_TERMS];
+        double asinC[ASIN_TERMS];
+
+        PolyCoefficients()
+        {
+            double f = 1; // running factorial
+            for (int k = 1; k <= COS_TERMS; k++)
+            {
+                f *= 2 * k - 1;
+                f *= 2 * k;     // f = (2k)!
+                cosC[k - 1] = (k % 2 ? -1 : 1) / f;
+                if (k <= SIN_TERMS)
+                    sinC[k - 1] = (k % 2 ? -1 : 1) / (f * (2 * k + 1));
+            }
+            double t = 1; // (2n)! / (4^n (n!)^2)
+            for (int n = 1; n <= ASIN_TERMS; n++)
+            {
+                t *= (2.0 * n - 1) / (2.0 * n);
+                asinC[n - 1] = t / (2 * n + 1);
+            }
+        }
+    };
+
+    const PolyCoefficients& coefficients()
+    {
+        static const PolyCoefficients c;
+        return c;
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d horner(const double* c, int n, __m256d z)
+    {
+        __m256d p = _mm256_set1_pd(c[n - 1]);
+        for (int k = n - 2; k >= 0; k--)
+            p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(c[k]));
+        return p;
+    }
+
+      // sin(x)^2 for |x| up to a few pi.
+    __attribute__((target("avx2,fma")))
+    inline __m256d sinSquared(__m256d x, const PolyCoefficients& pc)
+    {
+        const __m256d pio2Hi = _mm256_set1_pd(1.57079632673412561417e+00);
+        const __m256d pio2Lo = _mm256_set1_pd(6.07710050650619224932e-11);
+        const __m256d one = _mm256_set1_pd(1.0);
+
+        __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(2 / PI)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(k, pio2Hi, x);
+        r = _mm256_fnmadd_pd(k, pio2Lo, r);
+        __m256d z = _mm256_mul_pd(r, r);
+
+        __m256d s = _mm256_mul_pd(r, _mm256_fmadd_pd(z, horner(pc.sinC, SIN_TERMS, z), one));
+        __m256d c = _mm256_fmadd_pd(z, horner(pc.cosC, COS_TERMS, z), one);
+
+          // sin(r + k*pi/2) is +-sin(r) for even k and +-cos(r) for odd k.
+        __m256d halfK = _mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.5)));
+        __m256d odd = _mm256_cmp_pd(_mm256_fnmadd_pd(halfK, _mm256_set1_pd(2.0), k),
+                                    _mm256_setzero_pd(), _CMP_NEQ_OQ);
+        __m256d v = _mm256_blendv_pd(s, c, odd);
+        return _mm256_mul_pd(v, v);
+    }
+
+      // asin(y) for 0 <= y <= 1.
+    __attribute__((target("avx2,fma")))
+    inline __m256d arcsine(__m256d y, const PolyCoefficients& pc)
+    {
+        const __m256d half = _mm256_set1_pd(0.5);
+          // Above 1/2 use asin(y) = pi/2 - 2 asin(sqrt((1 - y) / 2)).
+        __m256d big = _mm256_cmp_pd(y, half, _CMP_GT_OQ);
+        __m256d folded = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), y), half));
+        __m256d t = _mm256_blendv_pd(y, folded, big);
+        __m256d z = _mm256_mul_pd(t, t);
+        __m256d p = _mm256_fmadd_pd(_mm256_mul_pd(t, z), horner(pc.asinC, ASIN_TERMS, z), t);
+        __m256d unfolded = _mm256_fnmadd_pd(_mm256_set1_pd(2.0), p, _mm256_set1_pd(PI / 2));
+        return _mm256_blendv_pd(p, unfolded, big);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256d loadSpan(const double* p, size_t i, bool repeated)
+    {
+        return repeated ? _mm256_broadcast_sd(p) : _mm256_loadu_pd(p + i);
+    }
+
+      // Handles the largest multiple of four pairs; returns how many it did.
+    __attribute__((target("avx2,fma")))
+    size_t avx2Kernel(const PointSpan& a, const PointSpan& b, double* out,
+                      size_t n, DistanceMode mode)
+    {
+        const PolyCoefficients& pc = coefficients();
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d pi = _mm256_set1_pd(PI);
+        const __m256d minusPi = _mm256_set1_pd(-PI);
+        const __m256d twoPi = _mm256_set1_pd(2 * PI);
+        const __m256d radius = _mm256_set1_pd(EARTH_RADIUS_MILES);
+
+        size_t done = n - n % 4;
+        for (size_t i = 0; i < done; i += 4)
+        {
+            __m256d lat1 = loadSpan(a.lat, i, a.repeated);
+            __m256d lon1 = loadSpan(a.lon, i, a.repeated);
+            __m256d cos1 = loadSpan(a.cosLat, i, a.repeated);
+            __m256d lat2 = loadSpan(b.lat, i, b.repeated);
+            __m256d lon2 = loadSpan(b.lon, i, b.repeated);
+            __m256d cos2 = loadSpan(b.cosLat, i, b.repeated);
+            __m256d dLat = _mm256_sub_pd(lat2, lat1);
+            __m256d dLon = _mm256_sub_pd(lon2, lon1);
+
+            __m256d d;
+            if (mode == HAVERSINE)
+            {
+                __m256d u2 = sinSquared(_mm256_mul_pd(dLat, half), pc);
+                __m256d v2 = sinSquared(_mm256_mul_pd(dLon, half), pc);
+                __m256d h = _mm256_fmadd_pd(_mm256_mul_pd(cos1, cos2), v2, u2);
+                h = _mm256_min_pd(h, one);
+                d = _mm256_mul_pd(_mm256_mul_pd(radius, _mm256_set1_pd(2.0)),
+                                  arcsine(_mm256_sqrt_pd(h), pc));
+            }
+            else
+            {
+                dLon = _mm256_sub_pd(dLon, _mm256_and_pd(_mm256_cmp_pd(dLon, pi, _CMP_GT_OQ), twoPi));
+                dLon = _mm256_add_pd(dLon, _mm256_and_pd(_mm256_cmp_pd(dLon, minusPi, _CMP_LT_OQ), twoPi));
+                __m256d x = _mm256_mul_pd(dLon, _mm256_mul_pd(_mm256_add_pd(cos1, cos2), half));
+                __m256d r2 = _mm256_fmadd_pd(x, x, _mm256_mul_pd(dLat, dLat));
+                d = _mm256_mul_pd(radius, _mm256_sqrt_pd(r2));
+            }
+            _mm256_storeu_pd(out + i, d);
+        }
+        return done;
+    }
+
+    bool detectAVX2()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+#endif // GOOBER_X86_KERNEL
+
+    void runKernel(const PointSpan& a, const PointSpan& b, double* out, size_t n, DistanceMode mode)
+    {
+        size_t done = 0;
+#if GOOBER_X86_KERNEL
+        if (distanceKernelUsesAVX2())
+            done = avx2Kernel(a, b, out, n, mode);
+#endif
+        scalarKernel(a, b, out, done, n, mode);
+    }
+
+    PointSpan spanOf(const GeoPointBuffer& pts, size_t from, bool repeated)
+    {
+        PointSpan s;
+        s.lat = pts.lat.data() + from;
+        s.lon = pts.lon.data() + from;
+        s.cosLat = pts.cosLat.data() + from;
+        s.repeated = repeated;
+        return s;
+    }
+}
+
+void GeoPointBuffer::push_back(const GeoCoord& g)
+{
+    double latRad = g.latitude * PI / 180;
+    lat.push_back(latRad);
+    lon.push_back(g.longitude * PI / 180);
+    cosLat.push_back(cos(latRad));
+}
+
+void GeoPointBuffer::reserve(size_t n)
+{
+    lat.reserve(n);
+    lon.reserve(n);
+    cosLat.reserve(n);
+}
+
+void batchDistanceMiles(const GeoPointBuffer& a, const GeoPointBuffer& b, double* out, DistanceMode mode)
+{
+    size_t n = (a.size() < b.size() ? a.size() : b.size());
+    if (n == 0)
+        return;
+    runKernel(spanOf(a, 0, false), spanOf(b, 0, false), out, n, mode);
+}
+
+void distancesFromMiles(const GeoPointBuffer& pts, size_t from, double* out, DistanceMode mode)
+{
+    if (from >= pts.size())
+        return;
+    runKernel(spanOf(pts, from, true), spanOf(pts, 0, false), out, pts.size(), mode);
+}
+
+void distancesFromMiles(const GeoCoord& origin, const GeoPointBuffer& pts, double* out, DistanceMode mode)
+{
+    if (pts.size() == 0)
+        return;
+    GeoPointBuffer o;
+    o.push_back(origin);
+    runKernel(spanOf(o, 0, true), spanOf(pts, 0, false), out, pts.size(), mode);
+}
+
+bool distanceKernelUsesAVX2()
+{
+#if GOOBER_X86_KERNEL
+    static const bool hasAVX2 = detectAVX2();
+    return hasAVX2;
+#else
+    return false;
+#endif
+}
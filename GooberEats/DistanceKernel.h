@@ -0,0 +1,64 @@
+#ifndef DISTANCEKERNEL_INCLUDED
+#define DISTANCEKERNEL_INCLUDED
+
+#include "provided.h"
+#include <vector>
+#include <cstddef>
+
+// Batch versions of distanceEarthMiles() over structure-of-arrays buffers.
+//
+// The per-pair helpers in provided.h convert degrees to radians and take four
+// trig calls for every pair. These kernels keep coordinates in radians with
+// cos(latitude) cached per point, and evaluate four pairs at a time with AVX2
+// when the CPU has it (scalar otherwise). The benchmark checks both modes
+// below against their stated accuracy.
+
+enum DistanceMode
+{
+      // Great-circle distance; agrees with distanceEarthMiles() to about one
+      // part in 1e13.
+    HAVERSINE,
+      // Flat-earth approximation using the mean of the two cached cosines.
+      // No trig at all. Relative error against HAVERSINE is at most
+      // EQUIRECTANGULAR_MAX_ERROR for points within the bounds below, but
+      // grows with the square of the distance and faster toward the poles,
+      // so use it for ranking and heuristics, not for reported mileage.
+    EQUIRECTANGULAR
+};
+
+  // EQUIRECTANGULAR's error bound, for points no more than
+  // EQUIRECTANGULAR_MAX_MILES apart and no more than
+  // EQUIRECTANGULAR_MAX_LATITUDE degrees from the equator. (Measured, it's
+  // about 5e-5 at the edges of that; a whole city is under 1e-6.)
+const double EQUIRECTANGULAR_MAX_ERROR = 1e-4;
+const double EQUIRECTANGULAR_MAX_MILES = 50;
+const double EQUIRECTANGULAR_MAX_LATITUDE = 70;
+
+  // Coordinates in radians, one array per field, plus cos(latitude).
+struct GeoPointBuffer
+{
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<double> cosLat;
+
+    void push_back(const GeoCoord& g);
+    void reserve(std::size_t n);
+    std::size_t size() const { return lat.size(); }
+};
+
+  // out[i] = miles between point i of a and point i of b (a and b same size).
+void batchDistanceMiles(const GeoPointBuffer& a, const GeoPointBuffer& b,
+                        double* out, DistanceMode mode = HAVERSINE);
+
+  // out[i] = miles from point `from` of pts to point i of pts.
+void distancesFromMiles(const GeoPointBuffer& pts, std::size_t from,
+                        double* out, DistanceMode mode = HAVERSINE);
+
+  // out[i] = miles from origin to point i of pts.
+void distancesFromMiles(const GeoCoord& origin, const GeoPointBuffer& pts,
+                        double* out, DistanceMode mode = HAVERSINE);
+
+  // True if the batch functions above run the AVX2 code path on this CPU.
+bool distanceKernelUsesAVX2();
+
+#endif // DISTANCEKERNEL_INCLUDED
@@ -0,0 +1,42 @@
+#include "DistanceMatrix.h"
+#include "DistanceKernel.h"
+using namespace std;
+
+void DistanceMatrix::buildCrowFlies(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries, DistanceMode mode)
+{
+    GeoPointBuffer pts;
+    pts.reserve(deliveries.size() + 1);
+    pts.push_back(depot);
+    for (int i = 0; i < deliveries.size(); i++)
+        pts.push_back(deliveries[i].location);
+
+    resize(static_cast<int>(pts.size()), true);
+    for (int from = 0; from < m_n; from++)
+        distancesFromMiles(pts, from, &m_d[static_cast<size_t>(from) * m_n], mode);
+}
+
+void DistanceMatrix::resize(int n, bool symmetric)
+{
+    m_n = n;
+    m_symmetric = symmetric;
+    m_d.assign(static_cast<size_t>(n) * n, 0.0);
+}
+
+double tourLength(const DistanceMatrix& d, const vector<int>& tour)
+{
+    if (tour.empty())
+        return 0;
+    double length = d(0, tour[0]);
+    for (int i = 0; i + 1 < tour.size(); i++)
+        length += d(tour[i], tour[i+1]);
+    length += d(tour.back(), 0);
+    return length;
+}
+
+vector<int> identityTour(int n)
+{
+    vector<int> tour(n);
+    for (int i = 0; i < n; i++)
+        tour[i] = i + 1;
+    return tour;
+}
@@ -0,0 +1,47 @@
+#ifndef DISTANCEMATRIX_INCLUDED
+#define DISTANCEMATRIX_INCLUDED
+
+#include "provided.h"
+#include "DistanceKernel.h"
+#include <vector>
+
+// Pairwise distances between the depot and a set of deliveries. Node 0 is the
+// depot and node i (1 <= i <= deliveries.size()) is deliveries[i-1], so a tour
+// is a permutation of 1..n and the depot is implied at both ends.
+
+class DistanceMatrix
+{
+public:
+    DistanceMatrix()
+     : m_n(0), m_symmetric(true)
+    {}
+
+      // Fill with crow-flies miles between every pair of nodes.
+    void buildCrowFlies(const GeoCoord& depot, const std::vector<DeliveryRequest>& deliveries,
+                        DistanceMode mode = HAVERSINE);
+
+      // Make an n x n matrix of zeros for the caller to fill in with set().
+    void resize(int n, bool symmetric);
+
+    int size() const { return m_n; }
+    bool symmetric() const { return m_symmetric; }
+
+    double operator()(int from, int to) const { return m_d[static_cast<size_t>(from) * m_n + to]; }
+    void set(int from, int to, double miles) { m_d[static_cast<size_t>(from) * m_n + to] = miles; }
+
+      // Pointer to row `from`, m_n entries long.
+    const double* row(int from) const { return &m_d[static_cast<size_t>(from) * m_n]; }
+
+private:
+    int m_n;
+    bool m_symmetric;
+    std::vector<double> m_d;
+};
+
+  // Length of depot -> tour[0] -> ... -> tour.back() -> depot.
+double tourLength(const DistanceMatrix& d, const std::vector<int>& tour);
+
+  // The tour 1, 2, ..., n, i.e. the deliveries in the order given.
+std::vector<int> identityTour(int n);
+
+#endif // DISTANCEMATRIX_INCLUDED
@@ -1,5 +1,11 @@
 // ExpandableHashMap.h
 
+#ifndef EXPANDABLEHASHMAP_INCLUDED
+#define EXPANDABLEHASHMAP_INCLUDED
+
+#include <vector>
+#include <list>
+
 // Skeleton for the ExpandableHashMap class template.  You must implement the first six
 // member functions.
 
@@ -28,7 +34,11 @@ public:
     // first overload, which you must implement.
     
 	  // for a map that can't be modified, return a pointer to const ValueType
-	const ValueType* find(const KeyType& key) const;
+	const ValueType* find(const KeyType& key) const
+	{
+		int probes = 0; // unread, so the counting is optimized away
+		return find(key, probes);
+	}
 
 	  // for a modifiable map, return a pointer to modifiable ValueType
 	ValueType* find(const KeyType& key)
@@ -36,6 +46,16 @@ public:
 		return const_cast<ValueType*>(const_cast<const ExpandableHashMap*>(this)->find(key));
 	}
 
+	  // Both of the above, adding the number of keys compared to probes.
+	template<typename Count>
+	const ValueType* find(const KeyType& key, Count& probes) const;
+
+	template<typename Count>
+	ValueType* find(const KeyType& key, Count& probes)
+	{
+		return const_cast<ValueType*>(const_cast<const ExpandableHashMap*>(this)->find(key, probes));
+	}
+
 	  // C++11 syntax for preventing copying and assignment
 	ExpandableHashMap(const ExpandableHashMap&) = delete;
 	ExpandableHashMap& operator=(const ExpandableHashMap&) = delete;
@@ -56,6 +76,7 @@ private:
     }
     std::vector<std::list<Node>*> m_buckets;
     double m_maxLoadFactor;
+    int m_size; // number of associations, kept so size() doesn't walk every bucket
 };
 
 template<typename KeyType, typename ValueType>
@@ -63,6 +84,7 @@ inline
 ExpandableHashMap<KeyType, ValueType>::ExpandableHashMap(double maximumLoadFactor)
 {
     m_maxLoadFactor = maximumLoadFactor;
+    m_size = 0;
     m_buckets = std::vector<std::list<Node>*> (8);
     for (int i = 0; i < m_buckets.size(); i++)
     {
@@ -93,18 +115,14 @@ void ExpandableHashMap<KeyType, ValueType>::reset()
     {
         m_buckets[i] = new std::list<Node>;
     }
+    m_size = 0;
 }
 
 template<typename KeyType, typename ValueType>
 inline
 int ExpandableHashMap<KeyType, ValueType>::size() const
 {
-    int total = 0;
-    for (int i = 0; i < m_buckets.size(); i++)
-    {
-        total += m_buckets[i]->size();
-    }
-    return total;
+    return m_size;
 }
 
 // The associate method associates one item (key) with another (value).
@@ -129,6 +147,7 @@ void ExpandableHashMap<KeyType, ValueType>::associate(const KeyType& key, const
         keyValuePair.m_key = key;
         keyValuePair.m_value = value;
         m_buckets[bucketNumber]->push_back(keyValuePair);
+        m_size++;
     }
     
     // rehash
@@ -149,11 +168,14 @@ void ExpandableHashMap<KeyType, ValueType>::associate(const KeyType& key, const
             typename std::list<Node>::iterator it = m_buckets[i]->begin();
             while (it != m_buckets[i]->end())
             {
-                list<Node>* newBucket = newBuckets[getBucketNumber((*it).m_key, newBuckets.size())];
+                std::list<Node>* newBucket = newBuckets[getBucketNumber((*it).m_key, newBuckets.size())];
                 newBucket->splice(newBucket->begin(), *m_buckets[i], it++);
             }
         }
-        m_buckets.resize(2 * m_buckets.size());
+        for (int i = 0; i < m_buckets.size(); i++)
+        {
+            delete m_buckets[i]; // already emptied by the splices above
+        }
         m_buckets = newBuckets;
 //        cerr << "rehashed" << endl;
 //        cerr << "new size: " << m_buckets.size() << endl;
@@ -164,14 +186,16 @@ void ExpandableHashMap<KeyType, ValueType>::associate(const KeyType& key, const
 
 // for a modifiable map, return a pointer to modifiable ValueType
 template<typename KeyType, typename ValueType>
+template<typename Count>
 inline
-const ValueType* ExpandableHashMap<KeyType, ValueType>::find(const KeyType& key) const
+const ValueType* ExpandableHashMap<KeyType, ValueType>::find(const KeyType& key, Count& probes) const
 {
     unsigned int bucketNumber = getBucketNumber(key, m_buckets.size());
     std::list<Node>* bucketList = m_buckets[bucketNumber];
     typename std::list<Node>::iterator it = bucketList->begin();
     while (it != bucketList->end())
     {
+        probes++;
         if (it->m_key == key)
         {
 //            cerr << "Found key!" << endl;
@@ -183,3 +207,4 @@ const ValueType* ExpandableHashMap<KeyType, ValueType>::find(const KeyType& key)
     return nullptr;
 }
 
+#endif // EXPANDABLEHASHMAP_INCLUDED
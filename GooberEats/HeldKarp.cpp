@@ -0,0 +1,136 @@
+#include "HeldKarp.h"
+#include <limits>
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOOBER_X86_KERNEL 1
+#include <immintrin.h>
+#else
+#define GOOBER_X86_KERNEL 0
+#endif
+
+// Table layout: best[S * stride + j] is the length of the shortest path that
+// leaves the depot, visits exactly the stops in bitmask S, and ends at stop j
+// (stop j is node j+1 of the matrix). Entries for j outside S, and the padding
+// out to a multiple of four, hold infinity, so extending a path to stop k is a
+// dense, branch-free min over one row plus one column of distances. The
+// distances are stored transposed (toStop[k * stride + j] = d(j+1, k+1)) so
+// that column is contiguous too.
+
+namespace
+{
+    const double INF = numeric_limits<double>::infinity();
+
+    double minPlusScalar(const double* a, const double* b, int stride)
+    {
+        double best = INF;
+        for (int j = 0; j < stride; j++)
+        {
+            double v = a[j] + b[j];
+            if (v < best)
+                best = v;
+        }
+        return best;
+    }
+
+#if GOOBER_X86_KERNEL
+    __attribute__((target("avx2")))
+    double minPlusAVX2(const double* a, const double* b, int stride)
+    {
+        __m256d best = _mm256_set1_pd(INF);
+        for (int j = 0; j < stride; j += 4)
+            best = _mm256_min_pd(best, _mm256_add_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j)));
+        __m128d half = _mm_min_pd(_mm256_castpd256_pd128(best), _mm256_extractf128_pd(best, 1));
+        return _mm_cvtsd_f64(_mm_min_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+
+    bool detectAVX2()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+
+      // min over j of a[j] + b[j]; stride is a multiple of four.
+    double minPlus(const double* a, const double* b, int stride)
+    {
+#if GOOBER_X86_KERNEL
+        static const bool hasAVX2 = detectAVX2();
+        if (hasAVX2)
+            return minPlusAVX2(a, b, stride);
+#endif
+        return minPlusScalar(a, b, stride);
+    }
+}
+
+vector<int> solveHeldKarp(const DistanceMatrix& d)
+{
+    int n = d.size() - 1;
+    if (n < 1 || n > HELD_KARP_MAX_STOPS)
+        return identityTour(max(n, 0));
+
+    int stride = (n + 3) / 4 * 4;
+    size_t subsets = static_cast<size_t>(1) << n;
+
+    vector<double> toStop(static_cast<size_t>(n) * stride, INF);
+    for (int k = 0; k < n; k++)
+        for (int j = 0; j < n; j++)
+            toStop[k * stride + j] = d(j + 1, k + 1);
+
+    vector<double> best(subsets * stride, INF);
+    for (int k = 0; k < n; k++)
+        best[(static_cast<size_t>(1) << k) * stride + k] = d(0, k + 1);
+
+    for (size_t S = 1; S < subsets; S++)
+    {
+        if ((S & (S - 1)) == 0)
+            continue; // single stops were seeded above
+        double* row = &best[S * stride];
+        for (int k = 0; k < n; k++)
+        {
+            if (!(S & (static_cast<size_t>(1) << k)))
+                continue;
+            size_t without = S ^ (static_cast<size_t>(1) << k);
+            row[k] = minPlus(&best[without * stride], &toStop[k * stride], stride);
+        }
+    }
+
+      // Close the tour at whichever last stop is cheapest, then walk back
+      // through the table, at each step finding the predecessor whose entry
+      // accounts for the current one.
+    size_t S = subsets - 1;
+    int last = 0;
+    double bestLength = INF;
+    for (int k = 0; k < n; k++)
+    {
+        double length = best[S * stride + k] + d(k + 1, 0);
+        if (length < bestLength)
+        {
+            bestLength = length;
+            last = k;
+        }
+    }
+
+    vector<int> tour(n);
+    for (int pos = n - 1; pos >= 0; pos--)
+    {
+        tour[pos] = last + 1;
+        size_t without = S ^ (static_cast<size_t>(1) << last);
+        if (without == 0)
+            break;
+        int prev = -1;
+        double prevBest = INF;
+        for (int j = 0; j < n; j++)
+        {
+            double v = best[without * stride + j] + toStop[last * stride + j];
+            if (v < prevBest)
+            {
+                prevBest = v;
+                prev = j;
+            }
+        }
+        S = without;
+        last = prev;
+    }
+    return tour;
+}
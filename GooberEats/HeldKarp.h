@@ -0,0 +1,18 @@
+#ifndef HELDKARP_INCLUDED
+#define HELDKARP_INCLUDED
+
+#include "DistanceMatrix.h"
+#include <vector>
+
+// Exact shortest tour by Held-Karp dynamic programming: O(2^n n^2) time and
+// O(2^n n) memory, so it is only offered for small batches.
+
+  // Largest batch solveHeldKarp() accepts (about 40 MB of table at 18 stops).
+const int HELD_KARP_MAX_STOPS = 18;
+
+  // Optimal tour through every delivery of d (node 0 is the depot), as a
+  // permutation of 1..n. Returns the identity tour if n exceeds
+  // HELD_KARP_MAX_STOPS.
+std::vector<int> solveHeldKarp(const DistanceMatrix& d);
+
+#endif // HELDKARP_INCLUDED
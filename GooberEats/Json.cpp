@@ -0,0 +1,370 @@
+#include "Json.h"
+#include <cstdio>
+#include <cmath>
+#include <cctype>
+using namespace std;
+
+const int MAX_JSON_DEPTH = 64;
+
+const JsonValue* JsonValue::member(const string& name) const
+{
+    if (m_type != JSON_OBJECT)
+        return nullptr;
+    for (int i = 0; i < m_names.size(); i++)
+    {
+        if (m_names[i] == name)
+            return &m_items[i];
+    }
+    return nullptr;
+}
+
+class JsonParser
+{
+public:
+    JsonParser(const string& text) : m_text(text), m_pos(0) {}
+    bool parse(JsonValue& value, string& error);
+private:
+    const string& m_text;
+    size_t m_pos;
+    string m_error;
+
+    bool fail(const string& what);
+    void skipSpace();
+    bool parseValue(JsonValue& value, int depth);
+    bool parseString(string& s);
+    bool parseNumber(string& s);
+    bool parseLiteral(const char* word);
+    bool parseHex4(unsigned int& code);
+};
+
+bool JsonParser::fail(const string& what)
+{
+    if (m_error.empty())
+        m_error = what + " at offset " + to_string(m_pos);
+    return false;
+}
+
+void JsonParser::skipSpace()
+{
+    while (m_pos < m_text.size() &&
+           (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r'))
+        m_pos++;
+}
+
+bool JsonParser::parse(JsonValue& value, string& error)
+{
+    JsonValue parsed;
+    skipSpace();
+    bool ok = parseValue(parsed, 0);
+    skipSpace();
+    if (ok && m_pos != m_text.size())
+        ok = fail("extra text after value");
+    if (!ok)
+    {
+        error = m_error;
+        return false;
+    }
+    swap(value, parsed);
+    return true;
+}
+
+bool JsonParser::parseLiteral(const char* word)
+{
+    size_t length = char_traits<char>::length(word);
+    if (m_text.compare(m_pos, length, word) != 0)
+        return fail("bad literal");
+    m_pos += length;
+    return true;
+}
+
+bool JsonParser::parseValue(JsonValue& value, int depth)
+{
+    if (depth > MAX_JSON_DEPTH)
+        return fail("nested too deeply");
+    if (m_pos >= m_text.size())
+        return fail("expected a value");
+
+    char c = m_text[m_pos];
+    if (c == '{')
+    {
+        value.m_type = JsonValue::JSON_OBJECT;
+        m_pos++;
+        skipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == '}')
+        {
+            m_pos++;
+            return true;
+        }
+        while (true)
+        {
+            skipSpace();
+            value.m_names.push_back(string());
+            if (m_pos >= m_text.size() || m_text[m_pos] != '"')
+                return fail("expected a member name");
+            if (!parseString(value.m_names.back()))
+                return false;
+            skipSpace();
+            if (m_pos >= m_text.size() || m_text[m_pos] != ':')
+                return fail("expected ':'");
+            m_pos++;
+            skipSpace();
+            value.m_items.push_back(JsonValue());
+            if (!parseValue(value.m_items.back(), depth + 1))
+                return false;
+            skipSpace();
+            if (m_pos < m_text.size() && m_text[m_pos] == ',')
+            {
+                m_pos++;
+                continue;
+            }
+            if (m_pos < m_text.size() && m_text[m_pos] == '}')
+            {
+                m_pos++;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+    if (c == '[')
+    {
+        value.m_type = JsonValue::JSON_ARRAY;
+        m_pos++;
+        skipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == ']')
+        {
+            m_pos++;
+            return true;
+        }
+        while (true)
+        {
+            skipSpace();
+            value.m_items.push_back(JsonValue());
+            if (!parseValue(value.m_items.back(), depth + 1))
+                return false;
+            skipSpace();
+            if (m_pos < m_text.size() && m_text[m_pos] == ',')
+            {
+                m_pos++;
+                continue;
+            }
+            if (m_pos < m_text.size() && m_text[m_pos] == ']')
+            {
+                m_pos++;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+    if (c == '"')
+    {
+        value.m_type = JsonValue::JSON_STRING;
+        return parseString(value.m_text);
+    }
+    if (c == 't' || c == 'f')
+    {
+        value.m_type = JsonValue::JSON_BOOL;
+        value.m_text = (c == 't' ? "true" : "false");
+        return parseLiteral(value.m_text.c_str());
+    }
+    if (c == 'n')
+    {
+        value.m_type = JsonValue::JSON_NULL;
+        return parseLiteral("null");
+    }
+    value.m_type = JsonValue::JSON_NUMBER;
+    return parseNumber(value.m_text);
+}
+
+bool JsonParser::parseNumber(string& s)
+{
+    size_t start = m_pos;
+    if (m_pos < m_text.size() && m_text[m_pos] == '-')
+        m_pos++;
+    size_t digits = m_pos;
+    while (m_pos < m_text.size() && isdigit(static_cast<unsigned char>(m_text[m_pos])))
+        m_pos++;
+    if (m_pos == digits)
+        return fail("expected a value");
+    if (m_pos < m_text.size() && m_text[m_pos] == '.')
+    {
+        m_pos++;
+        size_t fraction = m_pos;
+        while (m_pos < m_text.size() && isdigit(static_cast<unsigned char>(m_text[m_pos])))
+            m_pos++;
+        if (m_pos == fraction)
+            return fail("bad number");
+    }
+    if (m_pos < m_text.size() && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E'))
+    {
+        m_pos++;
+        if (m_pos < m_text.size() && (m_text[m_pos] == '+' || m_text[m_pos] == '-'))
+            m_pos++;
+        size_t exponent = m_pos;
+        while (m_pos < m_text.size() && isdigit(static_cast<unsigned char>(m_text[m_pos])))
+            m_pos++;
+        if (m_pos == exponent)
+            return fail("bad number");
+    }
+    s.assign(m_text, start, m_pos - start);
+    return true;
+}
+
+bool JsonParser::parseHex4(unsigned int& code)
+{
+    if (m_text.size() - m_pos < 4)
+        return fail("bad \\u escape");
+    code = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        char h = m_text[m_pos++];
+        code <<= 4;
+        if (h >= '0' && h <= '9') code |= h - '0';
+        else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+        else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+        else return fail("bad \\u escape");
+    }
+    return true;
+}
+
+  // Called with m_pos at the opening quote.
+bool JsonParser::parseString(string& s)
+{
+    m_pos++;
+    while (m_pos < m_text.size())
+    {
+        char c = m_text[m_pos++];
+        if (c == '"')
+            return true;
+        if (static_cast<unsigned char>(c) < 0x20)
+            return fail("control character in string");
+        if (c != '\\')
+        {
+            s += c;
+            continue;
+        }
+        if (m_pos >= m_text.size())
+            break;
+        char e = m_text[m_pos++];
+        switch (e)
+        {
+          case '"': s += '"'; break;
+          case '\\': s += '\\'; break;
+          case '/': s += '/'; break;
+          case 'b': s += '\b'; break;
+          case 'f': s += '\f'; break;
+          case 'n': s += '\n'; break;
+          case 'r': s += '\r'; break;
+          case 't': s += '\t'; break;
+          case 'u':
+          {
+            unsigned int code;
+            if (!parseHex4(code))
+                return false;
+            if (code >= 0xd800 && code < 0xdc00)
+            {
+                  // A high surrogate; the low half must follow.
+                unsigned int low;
+                if (m_text.compare(m_pos, 2, "\\u") != 0)
+                    return fail("unpaired surrogate");
+                m_pos += 2;
+                if (!parseHex4(low))
+                    return false;
+                if (low < 0xdc00 || low >= 0xe000)
+                    return fail("unpaired surrogate");
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            }
+              // UTF-8
+            if (code < 0x80)
+                s += static_cast<char>(code);
+            else if (code < 0x800)
+            {
+                s += static_cast<char>(0xc0 | (code >> 6));
+                s += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                s += static_cast<char>(0xe0 | (code >> 12));
+                s += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                s += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                s += static_cast<char>(0xf0 | (code >> 18));
+                s += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                s += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                s += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            break;
+          }
+          default:
+            return fail("bad escape");
+        }
+    }
+    return fail("unterminated string");
+}
+
+bool parseJson(const string& text, JsonValue& value, string& error)
+{
+    JsonParser parser(text);
+    return parser.parse(value, error);
+}
+
+void appendJsonString(string& out, const string& s)
+{
+    out += '"';
+    for (int i = 0; i < s.size(); i++)
+    {
+        char c = s[i];
+        switch (c)
+        {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                out += buf;
+            }
+            else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendJsonNumber(string& out, double x, int decimals)
+{
+    if (!std::isfinite(x))
+    {
+        out += "null"; // JSON has no infinity or NaN
+        return;
+    }
+    char buf[400]; // room for any double's integer digits
+    snprintf(buf, sizeof(buf), "%.*f", decimals, x);
+    out += buf;
+}
+
+void appendJsonBase64(string& out, const string& bytes)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out.reserve(out.size() + 2 + (bytes.size() + 2) / 3 * 4);
+    out += '"';
+    for (size_t i = 0; i < bytes.size(); i += 3)
+    {
+        size_t left = bytes.size() - i;
+        unsigned long v = static_cast<unsigned long>(static_cast<unsigned char>(bytes[i])) << 16;
+        if (left > 1)
+            v |= static_cast<unsigned long>(static_cast<unsigned char>(bytes[i + 1])) << 8;
+        if (left > 2)
+            v |= static_cast<unsigned char>(bytes[i + 2]);
+        out += digits[(v >> 18) & 63];
+        out += digits[(v >> 12) & 63];
+        out += (left > 1 ? digits[(v >> 6) & 63] : '=');
+        out += (left > 2 ? digits[v & 63] : '=');
+    }
+    out += '"';
+}
@@ -0,0 +1,58 @@
+#ifndef JSON_INCLUDED
+#define JSON_INCLUDED
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Just enough JSON for the planning server's requests and replies: a parsed
+// value tree to read from, and helpers for writing.
+
+class JsonValue
+{
+public:
+    enum Type
+    {
+        JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT
+    };
+
+    JsonValue() : m_type(JSON_NULL) {}
+
+    Type type() const { return m_type; }
+
+      // A string's contents, a number as it was written (so "34.0625329"
+      // keeps every digit), or "true"/"false".
+    const std::string& text() const { return m_text; }
+    bool isTrue() const { return m_type == JSON_BOOL && m_text == "true"; }
+
+      // An array's elements.
+    int size() const { return static_cast<int>(m_items.size()); }
+    const JsonValue& operator[](int i) const { return m_items[i]; }
+
+      // An object's member called name, or nullptr if it has none.
+    const JsonValue* member(const std::string& name) const;
+
+private:
+    Type m_type;
+    std::string m_text;
+    std::vector<JsonValue> m_items;
+    std::vector<std::string> m_names;   // for an object, m_items[i] is called m_names[i]
+
+    friend class JsonParser;
+};
+
+  // Parse text, which must hold exactly one JSON value. On failure, returns
+  // false and sets error to say what was wrong and where.
+bool parseJson(const std::string& text, JsonValue& value, std::string& error);
+
+  // Append s to out as a quoted JSON string.
+void appendJsonString(std::string& out, const std::string& s);
+
+  // Append x to out as a JSON number with the given number of decimals.
+void appendJsonNumber(std::string& out, double x, int decimals);
+
+  // Append bytes to out as a quoted JSON string of their base64 (RFC 4648,
+  // padded), for binary data that has to travel in JSON.
+void appendJsonBase64(std::string& out, const std::string& bytes);
+
+#endif // JSON_INCLUDED
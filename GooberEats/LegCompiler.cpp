@@ -0,0 +1,70 @@
+#include "LegCompiler.h"
+using namespace std;
+
+static Direction directionForProceed(double angle)
+{
+    if (angle >= 0 && angle < 22.5) { return DIR_EAST; }
+    if (angle >= 22.5 && angle < 67.5) { return DIR_NORTHEAST; }
+    if (angle >= 67.5 && angle < 112.5) { return DIR_NORTH; }
+    if (angle >= 112.5 && angle < 157.5) { return DIR_NORTHWEST; }
+    if (angle >= 157.5 && angle < 202.5) { return DIR_WEST; }
+    if (angle >= 202.5 && angle < 247.5) { return DIR_SOUTHWEST; }
+    if (angle >= 247.5 && angle < 292.5) { return DIR_SOUTH; }
+    if (angle >= 292.5 && angle < 337.5) { return DIR_SOUTHEAST; }
+    else { return DIR_EAST; }
+}
+
+  // DIR_NONE for no turn.
+static Direction directionForTurn(double angle)
+{
+    if (angle < 1 || angle > 359) return DIR_NONE;
+    if (angle >= 1 && angle < 180) return DIR_LEFT;
+    else return DIR_RIGHT;
+}
+
+void compileLeg(const list<StreetSegment>& route, NameTable& names,
+                vector<PlanCommand>& commands, double& miles)
+{
+    if (route.empty())
+        return;
+
+      // street and heading describe the run of segments on the current
+      // street (its heading is that of its first segment). Segments are
+      // looked at in place, never copied. Names are interned only where the
+      // street changes: an id for every segment would cost a hash and a lock
+      // each, more than comparing neighbouring names does. Headings, too, are
+      // worked out only there, and the new street's is kept for its Proceed.
+    list<StreetSegment>::const_iterator it = route.begin();
+    const StreetSegment* prev = &*it;
+    int street = names.intern(prev->name);
+    double heading = angleOfLine(*prev);
+    double distDownStreet = distanceEarthMiles(prev->start, prev->end);
+
+    for (++it; it != route.end(); ++it)
+    {
+        const StreetSegment* seg = &*it;
+        if (seg->name != prev->name)
+        {
+            int name = names.intern(seg->name);
+            commands.push_back(makePlanCommand(PLAN_PROCEED, directionForProceed(heading), street, distDownStreet));
+            miles += distDownStreet;
+
+            double newHeading = angleOfLine(*seg);
+            double turn = newHeading - angleOfLine(*prev);
+            if (turn < 0)
+                turn += 360;
+            Direction dir = directionForTurn(turn);
+            if (dir != DIR_NONE)
+                commands.push_back(makePlanCommand(PLAN_TURN, dir, name));
+
+            street = name;
+            heading = newHeading;
+            distDownStreet = 0;
+        }
+        distDownStreet += distanceEarthMiles(seg->start, seg->end);
+        prev = seg;
+    }
+
+    commands.push_back(makePlanCommand(PLAN_PROCEED, directionForProceed(heading), street, distDownStreet));
+    miles += distDownStreet;
+}
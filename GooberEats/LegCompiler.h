@@ -0,0 +1,20 @@
+#ifndef LEGCOMPILER_INCLUDED
+#define LEGCOMPILER_INCLUDED
+
+#include "provided.h"
+#include "PlanCommand.h"
+#include <list>
+#include <vector>
+
+// Turning a route into driving commands. Every leg of a plan, the drive home
+// included, goes through this one function.
+
+  // Append the Proceed and Turn commands that drive route to commands, and add
+  // the distance driven to miles. Street names are interned in names. Each run
+  // of segments on one street becomes a Proceed; a change of street also gets
+  // a Turn unless it bends less than a degree either way. An empty route (a
+  // leg that starts where it ends) adds nothing.
+void compileLeg(const std::list<StreetSegment>& route, NameTable& names,
+                std::vector<PlanCommand>& commands, double& miles);
+
+#endif // LEGCOMPILER_INCLUDED
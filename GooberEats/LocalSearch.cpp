@@ -0,0 +1,253 @@
+#include "LocalSearch.h"
+#include "TourMoves.h"
+#include <algorithm>
+#include <deque>
+using namespace std;
+
+namespace
+{
+      // Moves must gain at least this much, so rounding can't cause cycling.
+    const double EPSILON = 1e-10;
+
+      // Pops between looks at the clock.
+    const int DEADLINE_INTERVAL = 256;
+
+    class LocalSearch
+    {
+    public:
+        LocalSearch(const DistanceMatrix& d, vector<int>& tour, int neighborCount);
+        long long run(chrono::steady_clock::time_point deadline);
+    private:
+        const DistanceMatrix& m_d;
+        vector<int>& m_tour;
+        int m_n;
+        int m_k;                  // neighbors per stop
+        vector<int> m_pos;        // m_pos[stop] = position of stop in m_tour
+        vector<int> m_neighbors;  // m_neighbors[(stop-1)*m_k + t], nearest first
+        deque<int> m_active;      // stops whose don't-look bit is off
+        vector<char> m_isActive;
+
+        const int* neighborsOf(int stop) const { return &m_neighbors[(stop - 1) * m_k]; }
+        void activate(int node);
+        void updatePositions(int from, int to);
+        bool twoOpt(int a);
+        bool orOpt(int a);
+    };
+
+    LocalSearch::LocalSearch(const DistanceMatrix& d, vector<int>& tour, int neighborCount)
+     : m_d(d), m_tour(tour), m_n(static_cast<int>(tour.size())),
+       m_k(max(1, min(neighborCount, m_n - 1))), m_pos(m_n + 1), m_isActive(m_n + 1, 0)
+    {
+        updatePositions(0, m_n - 1);
+
+        m_neighbors.resize(static_cast<size_t>(m_n) * m_k);
+        vector<int> candidates;
+        for (int a = 1; a <= m_n; a++)
+        {
+            candidates.clear();
+            for (int c = 1; c <= m_n; c++)
+                if (c != a)
+                    candidates.push_back(c);
+            const double* row = d.row(a);
+            partial_sort(candidates.begin(), candidates.begin() + m_k, candidates.end(),
+                         [row](int x, int y) { return row[x] < row[y]; });
+            copy(candidates.begin(), candidates.begin() + m_k, m_neighbors.begin() + (a - 1) * m_k);
+        }
+
+        for (int i = 0; i < m_n; i++)
+            activate(m_tour[i]);
+    }
+
+    void LocalSearch::activate(int node)
+    {
+        if (node == 0 || m_isActive[node])
+            return; // the depot never moves, so it needs no bit
+        m_isActive[node] = 1;
+        m_active.push_back(node);
+    }
+
+    void LocalSearch::updatePositions(int from, int to)
+    {
+        for (int i = from; i <= to; i++)
+            m_pos[m_tour[i]] = i;
+    }
+
+      // Replace the edge on one side of a with an edge to one of its near
+      // neighbors c, reversing the stretch in between.
+    bool LocalSearch::twoOpt(int a)
+    {
+        const DistanceMatrix& d = m_d;
+        int i = m_pos[a];
+        const int* near = neighborsOf(a);
+
+        int succA = nodeAt(m_tour, i + 1);
+        for (int t = 0; t < m_k; t++)
+        {
+            int c = near[t];
+            if (d(a, succA) - d(a, c) <= EPSILON)
+                break; // neighbors are sorted, so no later c can gain either
+            int j = m_pos[c];
+            if (j == i + 1)
+                continue;
+            int succC = nodeAt(m_tour, j + 1);
+            if (d(a, c) + d(succA, succC) - d(a, succA) - d(c, succC) < -EPSILON)
+            {
+                int lo = min(i, j) + 1;
+                int hi = max(i, j);
+                reverse(m_tour.begin() + lo, m_tour.begin() + hi + 1);
+                updatePositions(lo, hi);
+                activate(succA);
+                activate(c);
+                activate(succC);
+                return true;
+            }
+        }
+
+        int predA = nodeAt(m_tour, i - 1);
+        for (int t = 0; t < m_k; t++)
+        {
+            int c = near[t];
+            if (d(predA, a) - d(c, a) <= EPSILON)
+                break;
+            int j = m_pos[c];
+            if (j == i - 1)
+                continue;
+            int predC = nodeAt(m_tour, j - 1);
+            if (d(c, a) + d(predC, predA) - d(predA, a) - d(predC, c) < -EPSILON)
+            {
+                int lo = (j < i ? j : i);
+                int hi = (j < i ? i : j) - 1;
+                reverse(m_tour.begin() + lo, m_tour.begin() + hi + 1);
+                updatePositions(lo, hi);
+                activate(predA);
+                activate(c);
+                activate(predC);
+                return true;
+            }
+        }
+        return false;
+    }
+
+      // Move a run of up to three stops that starts or ends at a so that a
+      // sits next to one of its near neighbors c.
+    bool LocalSearch::orOpt(int a)
+    {
+        const DistanceMatrix& d = m_d;
+        int i = m_pos[a];
+        const int* near = neighborsOf(a);
+
+        for (int len = 1; len <= 3 && len < m_n; len++)
+        {
+              // a leads the run, which goes right after c.
+            if (i + len <= m_n)
+            {
+                int predA = nodeAt(m_tour, i - 1);
+                for (int t = 0; t < m_k; t++)
+                {
+                    int c = near[t];
+                    if (d(predA, a) - d(c, a) <= EPSILON)
+                        break;
+                    int k = m_pos[c];
+                    if (k >= i - 1 && k <= i + len - 1)
+                        continue;
+                    if (relocateDelta(d, m_tour, i, len, k) < -EPSILON)
+                    {
+                        int succC = nodeAt(m_tour, k + 1);
+                        int last = m_tour[i + len - 1];
+                        int succLast = nodeAt(m_tour, i + len);
+                        relocate(m_tour, i, len, k);
+                        updatePositions(min(i, k + 1), max(i + len - 1, k));
+                        activate(predA);
+                        activate(succLast);
+                        activate(c);
+                        activate(succC);
+                        activate(last);
+                        return true;
+                    }
+                }
+            }
+
+              // a ends the run, which goes right before c.
+            if (i - len + 1 >= 0)
+            {
+                int start = i - len + 1;
+                int succA = nodeAt(m_tour, i + 1);
+                for (int t = 0; t < m_k; t++)
+                {
+                    int c = near[t];
+                    if (d(a, succA) - d(a, c) <= EPSILON)
+                        break;
+                    int k = m_pos[c] - 1;
+                    if (k >= start - 1 && k <= i)
+                        continue;
+                    if (relocateDelta(d, m_tour, start, len, k) < -EPSILON)
+                    {
+                        int predC = nodeAt(m_tour, k);
+                        int first = m_tour[start];
+                        int predFirst = nodeAt(m_tour, start - 1);
+                        relocate(m_tour, start, len, k);
+                        updatePositions(min(start, k + 1), max(i, k));
+                        activate(predFirst);
+                        activate(succA);
+                        activate(c);
+                        activate(predC);
+                        activate(first);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    long long LocalSearch::run(chrono::steady_clock::time_point deadline)
+    {
+        long long moves = 0;
+        long long pops = 0;
+        bool useTwoOpt = m_d.symmetric();
+        while (!m_active.empty())
+        {
+            if (++pops % DEADLINE_INTERVAL == 0 && chrono::steady_clock::now() >= deadline)
+                break;
+            int a = m_active.front();
+            m_active.pop_front();
+            m_isActive[a] = 0;
+            if ((useTwoOpt && twoOpt(a)) || orOpt(a))
+            {
+                moves++;
+                activate(a);
+            }
+        }
+        return moves;
+    }
+}
+
+vector<int> nearestNeighborTour(const DistanceMatrix& d)
+{
+    int n = d.size() - 1;
+    vector<int> tour;
+    tour.reserve(max(n, 0));
+    vector<char> visited(d.size(), 0);
+    int current = 0;
+    for (int step = 0; step < n; step++)
+    {
+        const double* row = d.row(current);
+        int next = -1;
+        for (int c = 1; c <= n; c++)
+            if (!visited[c] && (next == -1 || row[c] < row[next]))
+                next = c;
+        visited[next] = 1;
+        tour.push_back(next);
+        current = next;
+    }
+    return tour;
+}
+
+long long improveTour(const DistanceMatrix& d, vector<int>& tour, int neighborCount,
+                      chrono::steady_clock::time_point deadline)
+{
+    if (tour.size() < 3)
+        return 0;
+    LocalSearch search(d, tour, neighborCount);
+    return search.run(deadline);
+}
@@ -0,0 +1,26 @@
+#ifndef LOCALSEARCH_INCLUDED
+#define LOCALSEARCH_INCLUDED
+
+#include "DistanceMatrix.h"
+#include <vector>
+#include <chrono>
+
+// Local search over tours: 2-opt and Or-opt moves, each tried only against a
+// stop's nearest neighbors, with don't-look bits so a stop is re-examined only
+// after an edge next to it changes.
+
+  // How many nearest stops each stop considers as new neighbors by default.
+const int DEFAULT_NEIGHBOR_COUNT = 8;
+
+  // Greedy tour: from the depot, always go to the nearest unvisited stop.
+std::vector<int> nearestNeighborTour(const DistanceMatrix& d);
+
+  // Apply improving moves to tour (a permutation of 1..n) until it is a local
+  // optimum or the deadline passes. 2-opt is only used when d is symmetric;
+  // Or-opt relocates runs of one to three stops without reversing them, so it
+  // is valid either way. Returns the number of moves applied.
+long long improveTour(const DistanceMatrix& d, std::vector<int>& tour,
+                      int neighborCount = DEFAULT_NEIGHBOR_COUNT,
+                      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+#endif // LOCALSEARCH_INCLUDED
@@ -0,0 +1,137 @@
+#include "NearestDepot.h"
+#include "Trace.h"
+#include <queue>
+#include <limits>
+#include <chrono>
+#include <functional>
+using namespace std;
+
+namespace
+{
+    const double INF = numeric_limits<double>::infinity();
+
+      // Ordered by miles, then depot, so ties go to the lower depot index.
+    struct QueueEntry
+    {
+        double miles;
+        int depot;
+        int node;
+        bool operator>(const QueueEntry& other) const
+        {
+            return miles > other.miles || (miles == other.miles && depot > other.depot);
+        }
+    };
+}
+
+NearestDepots::NearestDepots(const StreetMap* sm)
+ : m_graph(sm)
+{
+}
+
+  // Dijkstra seeded with every depot at distance 0. m_depot[v] is the depot
+  // whose search got to v first; like RoadMatrix::search, the arrays grow as
+  // new nodes are found.
+template<typename Count>
+void NearestDepots::sweep(const vector<int>& sources, SearchCounts<Count>& counts)
+{
+    m_depot.assign(m_graph.nodeCount(), -1);
+    m_miles.assign(m_graph.nodeCount(), INF);
+    vector<char> settled(m_graph.nodeCount(), 0);
+
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    for (int d = 0; d < sources.size(); d++)
+    {
+        if (m_depot[sources[d]] == -1)
+        {
+            m_depot[sources[d]] = d;
+            m_miles[sources[d]] = 0;
+            QueueEntry entry = { 0, d, sources[d] };
+            openSet.push(entry);
+            counts.pushes++;
+        }
+    }
+
+    while (!openSet.empty())
+    {
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        counts.pops++;
+        int current = top.node;
+        if (settled[current])
+            continue;
+        settled[current] = 1;
+        counts.settled++;
+
+        const vector<StreetGraph::Edge>& edges = m_graph.edgesFrom(current);
+        if (m_depot.size() < m_graph.nodeCount())
+        {
+            m_depot.resize(m_graph.nodeCount(), -1);
+            m_miles.resize(m_graph.nodeCount(), INF);
+            settled.resize(m_graph.nodeCount(), 0);
+        }
+        for (int i = 0; i < edges.size(); i++)
+        {
+            counts.relaxed++;
+            double tentative = top.miles + edges[i].miles;
+            int neighbor = edges[i].to;
+            if (!settled[neighbor] &&
+                (tentative < m_miles[neighbor] || (tentative == m_miles[neighbor] && top.depot < m_depot[neighbor])))
+            {
+                m_miles[neighbor] = tentative;
+                m_depot[neighbor] = top.depot;
+                QueueEntry entry = { tentative, top.depot, neighbor };
+                openSet.push(entry);
+                counts.pushes++;
+            }
+        }
+    }
+}
+
+DeliveryResult NearestDepots::build(const vector<GeoCoord>& depots, RouteStats* stats)
+{
+    TraceSpan span("nearest depots");
+    span.arg("depots", static_cast<long long>(depots.size()));
+    vector<int> sources(depots.size());
+    for (int d = 0; d < depots.size(); d++)
+    {
+        sources[d] = m_graph.nodeFor(depots[d]);
+        if (sources[d] == -1)
+        {
+            m_depot.clear();
+            m_miles.clear();
+            return BAD_COORD;
+        }
+    }
+
+    if (stats == nullptr)
+    {
+        SearchCounts<NoCount> counts;
+        sweep(sources, counts);
+    }
+    else
+    {
+        SearchCounts<long long> counts;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        sweep(sources, counts);
+        stats->milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats->add(counts);
+    }
+    return DELIVERY_SUCCESS;
+}
+
+int NearestDepots::nearest(const GeoCoord& g, double& miles) const
+{
+    int node = m_graph.knownNode(g);
+    if (node == -1 || node >= m_depot.size() || m_depot[node] == -1)
+        return -1;
+    miles = m_miles[node];
+    return m_depot[node];
+}
+
+void NearestDepots::assign(const vector<DeliveryRequest>& deliveries, vector<int>& depot, vector<double>& miles) const
+{
+    depot.assign(deliveries.size(), -1);
+    miles.assign(deliveries.size(), 0);
+    for (int i = 0; i < deliveries.size(); i++)
+        depot[i] = nearest(deliveries[i].location, miles[i]);
+}
@@ -0,0 +1,46 @@
+#ifndef NEARESTDEPOT_INCLUDED
+#define NEARESTDEPOT_INCLUDED
+
+#include "provided.h"
+#include "StreetGraph.h"
+#include "PlanStats.h"
+#include <vector>
+
+// Which of several depots is the shortest drive from each place on the map.
+// One Dijkstra search starts from every depot at once, so each node is
+// settled by whichever depot reaches it first, which is the nearest one.
+// After that one sweep, finding a delivery's depot is a single hash lookup,
+// rather than a route from every depot.
+
+class NearestDepots
+{
+public:
+    NearestDepots(const StreetMap* sm);
+
+      // Label every node that some depot can reach. Returns BAD_COORD if a
+      // depot isn't on the map.
+    DeliveryResult build(const std::vector<GeoCoord>& depots, RouteStats* stats = nullptr);
+
+      // Index into the depots given to build() of the depot nearest g, and the
+      // miles from it; -1 if g isn't on the map or no depot can reach it.
+      // Depots at the same distance go to the lower index.
+    int nearest(const GeoCoord& g, double& miles) const;
+
+      // nearest() for each delivery.
+    void assign(const std::vector<DeliveryRequest>& deliveries, std::vector<int>& depot,
+                std::vector<double>& miles) const;
+
+      // We prevent a NearestDepots object from being copied or assigned.
+    NearestDepots(const NearestDepots&) = delete;
+    NearestDepots& operator=(const NearestDepots&) = delete;
+
+private:
+    StreetGraph m_graph;
+    std::vector<int> m_depot;           // by graph node; -1 if unreached
+    std::vector<double> m_miles;
+
+    template<typename Count>
+    void sweep(const std::vector<int>& sources, SearchCounts<Count>& counts);
+};
+
+#endif // NEARESTDEPOT_INCLUDED
@@ -0,0 +1,160 @@
+#ifndef OPTIMIZEROPTIONS_INCLUDED
+#define OPTIMIZEROPTIONS_INCLUDED
+
+#include "provided.h"
+#include "DistanceMatrix.h"
+#include "WarmStart.h"
+#include "PlanStats.h"
+#include <vector>
+#include <chrono>
+
+// Knobs for DeliveryOptimizer. provided.h can't change, so callers that need
+// them use ConfigurableDeliveryOptimizer below; plain DeliveryOptimizer runs
+// with the defaults.
+
+enum ParallelMode
+{
+      // One annealing chain per thread, each independently seeded; the best
+      // final tour wins. With one thread this is plain annealing.
+    MULTI_START,
+      // One replica per thread (at least two), each held at a fixed
+      // temperature, swapping tours with its neighbors between rounds.
+    PARALLEL_TEMPERING
+};
+
+enum SearchStrategy
+{
+      // Simulated annealing only, as configured by parallelMode.
+    ANNEALING,
+      // Annealing, then local search from its best tour to a local optimum.
+    ANNEALING_THEN_LOCAL_SEARCH,
+      // Local search alone, from the better of the input order and a
+      // nearest-neighbor tour. Much faster than annealing on large batches.
+    LOCAL_SEARCH
+};
+
+enum DistanceMetric
+{
+      // Straight-line miles between stops. Cheap, but blind to the streets.
+    CROW_FLIES,
+      // Driving miles over the street map, one search per stop (see
+      // RoadMatrix.h). Worth it when the street grid makes straight-line
+      // distance a poor guide.
+    ROAD_DISTANCE
+};
+
+struct OptimizerOptions
+{
+    OptimizerOptions()
+     : deadline(std::chrono::steady_clock::time_point::max()), maxIterations(0),
+       seed(0), useSeed(false), startTemperature(100), finalTemperature(0.01), movesPerDelivery(1),
+       threads(1), parallelMode(MULTI_START), exactThreshold(12),
+       strategy(ANNEALING_THEN_LOCAL_SEARCH), neighborCount(8), metric(CROW_FLIES),
+       clusterSize(0), warmStartTemperature(0.1)
+    {}
+
+      // Stop once this time passes and return the best tour found so far.
+    std::chrono::steady_clock::time_point deadline;
+
+      // Stop after this many moves; 0 means the default schedule length. The
+      // cooling schedule is stretched over whichever of the deadline and the
+      // iteration cap would end the run first.
+    long long maxIterations;
+
+      // With useSeed set, the same seed and inputs give the same tour on a
+      // given build. Otherwise each run draws a fresh seed.
+    unsigned long long seed;
+    bool useSeed;
+
+      // Annealing temperature, in miles, at the start and end of the run.
+    double startTemperature;
+    double finalTemperature;
+
+      // Moves tried at each temperature step for every delivery, when there's
+      // no iteration cap. Each move is scored in constant time, so the default
+      // of 1 costs about what the original annealer's one whole-tour rescoring
+      // per step did. More finds somewhat shorter tours on large batches, in
+      // proportionally more time: with local search after, 10 gives tours
+      // 4-12% shorter at 200-400 stops, taking about eight times as long.
+    int movesPerDelivery;
+
+      // Threads to search on. They share one read-only distance matrix, and
+      // the deadline and iteration cap apply to each chain.
+    int threads;
+    ParallelMode parallelMode;
+
+      // Batches of at most this many deliveries are solved exactly with
+      // Held-Karp instead of annealed (capped at HELD_KARP_MAX_STOPS). Set to
+      // 0 to always anneal.
+    int exactThreshold;
+
+      // How larger batches are searched, and how many nearest stops local
+      // search considers for each stop.
+    SearchStrategy strategy;
+    int neighborCount;
+
+      // What the tour is shortened under. With ROAD_DISTANCE the distances
+      // reported by optimizeDeliveryOrder are still crow-flies, as documented
+      // there, but the order is the one that's shortest to drive.
+    DistanceMetric metric;
+
+      // Batches of more than twice this many deliveries are split into
+      // clusters of about this many nearby stops. The clusters are toured
+      // separately (on up to `threads` threads at once) and joined, and a
+      // local search pass then repairs the joins. Crow-flies miles for a split
+      // batch come from the flat-earth EQUIRECTANGULAR kernel (DistanceKernel.h),
+      // though the miles reported are great-circle. Set to 0 (the default) to
+      // always search the batch whole.
+    int clusterSize;
+
+      // A previous tour or saved order (see WarmStart.h), as locations in the
+      // order they were visited. When given, deliveries at those locations
+      // start in that order, the rest are inserted where they fit best, and
+      // annealing starts no hotter than warmStartTemperature, since it only
+      // has to adjust a good tour rather than untangle an arbitrary one.
+    std::vector<GeoCoord> orderHint;
+    double warmStartTemperature;
+
+      // Set the deadline to this many milliseconds from now.
+    void setTimeLimit(double milliseconds)
+    {
+        deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(milliseconds));
+    }
+
+    bool hasDeadline() const
+    {
+        return deadline != std::chrono::steady_clock::time_point::max();
+    }
+};
+
+class DeliveryOptimizerImpl;
+
+class ConfigurableDeliveryOptimizer
+{
+public:
+    ConfigurableDeliveryOptimizer(const StreetMap* sm, const OptimizerOptions& options = OptimizerOptions());
+    ~ConfigurableDeliveryOptimizer();
+      // If stats isn't null, the run is added to it.
+    void optimizeDeliveryOrder(
+        const GeoCoord& depot,
+        std::vector<DeliveryRequest>& deliveries,
+        double& oldCrowDistance,
+        double& newCrowDistance,
+        OptimizerStats* stats = nullptr) const;
+      // Reorder tour (a permutation of 1..n) to shorten it under d, whichever
+      // metric d was built with, starting from tour as given. With an
+      // orderHint set, tour should be the warmStartTour() for it. Returns the
+      // number of moves tried.
+    long long optimizeTour(const DistanceMatrix& d, std::vector<int>& tour, OptimizerStats* stats = nullptr) const;
+    const OptimizerOptions& options() const;
+    void setOptions(const OptimizerOptions& options);
+      // We prevent a ConfigurableDeliveryOptimizer object from being copied or assigned.
+    ConfigurableDeliveryOptimizer(const ConfigurableDeliveryOptimizer&) = delete;
+    ConfigurableDeliveryOptimizer& operator=(const ConfigurableDeliveryOptimizer&) = delete;
+private:
+    DeliveryOptimizerImpl* m_impl;
+};
+
+#endif // OPTIMIZEROPTIONS_INCLUDED
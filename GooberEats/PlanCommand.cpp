@@ -0,0 +1,78 @@
+#include "PlanCommand.h"
+using namespace std;
+
+unsigned int hasher(const string& s)
+{
+      // FNV-1a
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < s.size(); i++)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int NameTable::intern(const string& name)
+{
+    lock_guard<mutex> lock(m_mutex);
+    const int* found = m_index.find(name);
+    if (found != nullptr)
+        return *found;
+    int id = static_cast<int>(m_names.size());
+    m_names.push_back(name);
+    m_index.associate(name, id);
+    return id;
+}
+
+  // The lock is for the deque's index, which intern() can reallocate; the
+  // string itself never moves, so the reference stays good after unlocking.
+const string& NameTable::name(int id) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_names[id];
+}
+
+int NameTable::size() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return static_cast<int>(m_names.size());
+}
+
+const char* directionName(Direction dir)
+{
+    static const char* const names[] = {
+        "east", "northeast", "north", "northwest",
+        "west", "southwest", "south", "southeast",
+        "left", "right", ""
+    };
+    return names[dir];
+}
+
+PlanCommand makePlanCommand(PlanCommandType type, Direction dir, int name, double distance)
+{
+    PlanCommand command;
+    command.type = static_cast<uint8_t>(type);
+    command.direction = static_cast<uint8_t>(dir);
+    command.name = name;
+    command.distance = static_cast<float>(distance);
+    return command;
+}
+
+DeliveryCommand PlanCommand::toDeliveryCommand(const NameTable& names) const
+{
+    DeliveryCommand command;
+    switch (type)
+    {
+      case PLAN_PROCEED:
+        command.initAsProceedCommand(directionName(static_cast<Direction>(direction)), names.name(name), distance);
+        break;
+      case PLAN_TURN:
+        command.initAsTurnCommand(directionName(static_cast<Direction>(direction)), names.name(name));
+        break;
+      case PLAN_DELIVER:
+        command.initAsDeliverCommand(names.name(name));
+        break;
+    }
+    return command;
+}
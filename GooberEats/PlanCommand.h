@@ -0,0 +1,69 @@
+#ifndef PLANCOMMAND_INCLUDED
+#define PLANCOMMAND_INCLUDED
+
+#include "provided.h"
+#include "ExpandableHashMap.h"
+#include <string>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+// Compact commands for streaming and storing plans. A DeliveryCommand holds
+// its own copies of three strings; a PlanCommand is twelve bytes: its type,
+// its direction, the id of its street name (or item) in a NameTable, and its
+// distance. Text is only made when asked for (see PlanEncoding.h).
+
+  // Interned strings, numbered from 0 in the order they were added. Each
+  // distinct string is stored once and keeps its address for the life of the
+  // table. Safe to use from several threads at once.
+class NameTable
+{
+public:
+    NameTable() {}
+
+      // The id of name, adding it if it isn't there yet.
+    int intern(const std::string& name);
+
+    const std::string& name(int id) const;
+    int size() const;
+
+      // We prevent a NameTable object from being copied or assigned.
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+private:
+    mutable std::mutex m_mutex;
+    std::deque<std::string> m_names;    // deque, so growing it moves nothing
+    ExpandableHashMap<std::string, int> m_index;
+};
+
+enum PlanCommandType
+{
+    PLAN_PROCEED, PLAN_TURN, PLAN_DELIVER
+};
+
+enum Direction
+{
+    DIR_EAST, DIR_NORTHEAST, DIR_NORTH, DIR_NORTHWEST,
+    DIR_WEST, DIR_SOUTHWEST, DIR_SOUTH, DIR_SOUTHEAST,
+    DIR_LEFT, DIR_RIGHT,
+    DIR_NONE                    // Deliver commands have no direction
+};
+
+  // "east", "left", ...; "" for DIR_NONE.
+const char* directionName(Direction dir);
+
+struct PlanCommand
+{
+    std::uint8_t type;          // a PlanCommandType
+    std::uint8_t direction;     // a Direction
+    std::int32_t name;          // NameTable id of the street, or for Deliver the item
+    float distance;             // miles; 0 except for Proceed
+
+      // The equivalent DeliveryCommand, copying the strings out of names.
+    DeliveryCommand toDeliveryCommand(const NameTable& names) const;
+};
+
+PlanCommand makePlanCommand(PlanCommandType type, Direction dir, int name, double distance = 0);
+
+#endif // PLANCOMMAND_INCLUDED
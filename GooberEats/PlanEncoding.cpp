@@ -0,0 +1,191 @@
+#include "PlanEncoding.h"
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+const char PLAN_MAGIC[] = "GEPC";
+const int PLAN_VERSION = 1;
+const int PLAN_HEADER_BYTES = 16;
+const int PLAN_COMMAND_BYTES = 12;
+const int MAX_MILES_TEXT = 48;      // "%.2f" of any float fits
+
+static int formatMiles(float miles, char* buf)
+{
+      // The same rounding as an ostream set to fixed with precision 2.
+    return snprintf(buf, MAX_MILES_TEXT, "%.2f", static_cast<double>(miles));
+}
+
+  // The description's length, counting the miles at their longest.
+static size_t descriptionBound(const PlanCommand& command, const NameTable& names)
+{
+    size_t nameLength = names.name(command.name).size();
+    size_t dirLength = strlen(directionName(static_cast<Direction>(command.direction)));
+    switch (command.type)
+    {
+      case PLAN_PROCEED:
+        return 8 + dirLength + 4 + nameLength + 5 + MAX_MILES_TEXT + 6;
+      case PLAN_TURN:
+        return 5 + dirLength + 4 + nameLength;
+      case PLAN_DELIVER:
+        return 8 + nameLength;
+    }
+    return 0;
+}
+
+void appendDescription(const PlanCommand& command, const NameTable& names, string& out)
+{
+    const char* dir = directionName(static_cast<Direction>(command.direction));
+    const string& name = names.name(command.name);
+    switch (command.type)
+    {
+      case PLAN_PROCEED:
+      {
+        char miles[MAX_MILES_TEXT];
+        int length = formatMiles(command.distance, miles);
+        out.append("Proceed ").append(dir).append(" on ").append(name).append(" for ");
+        out.append(miles, length).append(" miles");
+        break;
+      }
+      case PLAN_TURN:
+        out.append("Turn ").append(dir).append(" on ").append(name);
+        break;
+      case PLAN_DELIVER:
+        out.append("DELIVER ").append(name);
+        break;
+    }
+}
+
+string describe(const PlanCommand& command, const NameTable& names)
+{
+    string text;
+    appendDescription(command, names, text);
+    return text;
+}
+
+void formatCommands(const vector<PlanCommand>& commands, const NameTable& names, string& out)
+{
+    size_t length = out.size();
+    for (int i = 0; i < commands.size(); i++)
+        length += descriptionBound(commands[i], names) + 1;
+    out.reserve(length);
+    for (int i = 0; i < commands.size(); i++)
+    {
+        appendDescription(commands[i], names, out);
+        out += '\n';
+    }
+}
+
+static void putU16(string& out, unsigned int v)
+{
+    out += static_cast<char>(v & 0xff);
+    out += static_cast<char>((v >> 8) & 0xff);
+}
+
+static void putU32(string& out, uint32_t v)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+        out += static_cast<char>((v >> shift) & 0xff);
+}
+
+static uint32_t getU32(const string& in, size_t at)
+{
+    uint32_t v = 0;
+    for (int k = 3; k >= 0; k--)
+        v = (v << 8) | static_cast<unsigned char>(in[at + k]);
+    return v;
+}
+
+void encodePlan(const vector<PlanCommand>& commands, const NameTable& names, string& out)
+{
+      // Number the names the plan uses by first use.
+    vector<int> index(names.size(), -1);
+    vector<int> used;
+    size_t nameBytes = 0;
+    for (int i = 0; i < commands.size(); i++)
+    {
+        int id = commands[i].name;
+        if (index[id] == -1)
+        {
+            index[id] = static_cast<int>(used.size());
+            used.push_back(id);
+            nameBytes += 4 + names.name(id).size();
+        }
+    }
+
+    out.reserve(out.size() + PLAN_HEADER_BYTES + nameBytes + PLAN_COMMAND_BYTES * commands.size());
+    out.append(PLAN_MAGIC, 4);
+    putU16(out, PLAN_VERSION);
+    putU16(out, 0);
+    putU32(out, static_cast<uint32_t>(used.size()));
+    putU32(out, static_cast<uint32_t>(commands.size()));
+    for (int k = 0; k < used.size(); k++)
+    {
+        const string& name = names.name(used[k]);
+        putU32(out, static_cast<uint32_t>(name.size()));
+        out += name;
+    }
+    for (int i = 0; i < commands.size(); i++)
+    {
+        const PlanCommand& command = commands[i];
+        out += static_cast<char>(command.type);
+        out += static_cast<char>(command.direction);
+        putU16(out, 0);
+        putU32(out, static_cast<uint32_t>(index[command.name]));
+        uint32_t bits;
+        memcpy(&bits, &command.distance, sizeof(bits));
+        putU32(out, bits);
+    }
+}
+
+bool decodePlan(const string& data, NameTable& names, vector<PlanCommand>& commands)
+{
+    if (data.size() < PLAN_HEADER_BYTES || data.compare(0, 4, PLAN_MAGIC) != 0 ||
+        getU32(data, 4) != PLAN_VERSION)    // the version, and zero flags
+        return false;
+    uint32_t nameCount = getU32(data, 8);
+    uint32_t commandCount = getU32(data, 12);
+
+      // Check everything before touching names or commands.
+    size_t at = PLAN_HEADER_BYTES;
+    vector<string> planNames;
+    for (uint32_t k = 0; k < nameCount; k++)
+    {
+        if (data.size() - at < 4)
+            return false;
+        uint32_t length = getU32(data, at);
+        at += 4;
+        if (data.size() - at < length)
+            return false;
+        planNames.push_back(data.substr(at, length));
+        at += length;
+    }
+    if ((data.size() - at) / PLAN_COMMAND_BYTES != commandCount ||
+        (data.size() - at) % PLAN_COMMAND_BYTES != 0)
+        return false;
+
+    vector<PlanCommand> planCommands(commandCount);
+    for (uint32_t i = 0; i < commandCount; i++, at += PLAN_COMMAND_BYTES)
+    {
+        PlanCommand& command = planCommands[i];
+        command.type = static_cast<unsigned char>(data[at]);
+        command.direction = static_cast<unsigned char>(data[at + 1]);
+        uint32_t name = getU32(data, at + 4);
+        uint32_t bits = getU32(data, at + 8);
+        if (command.type > PLAN_DELIVER || command.direction > DIR_NONE ||
+            data[at + 2] != 0 || data[at + 3] != 0 || name >= nameCount)
+            return false;
+        command.name = static_cast<int32_t>(name);
+        memcpy(&command.distance, &bits, sizeof(bits));
+    }
+
+    vector<int> ids(nameCount);
+    for (uint32_t k = 0; k < nameCount; k++)
+        ids[k] = names.intern(planNames[k]);
+    commands.reserve(commands.size() + commandCount);
+    for (uint32_t i = 0; i < commandCount; i++)
+    {
+        planCommands[i].name = ids[planCommands[i].name];
+        commands.push_back(planCommands[i]);
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef PLANENCODING_INCLUDED
+#define PLANENCODING_INCLUDED
+
+#include "PlanCommand.h"
+#include <string>
+#include <vector>
+
+// Turning PlanCommands into text, and into and out of a binary form that
+// clients can read without parsing text.
+
+  // Append the text DeliveryCommand::description() gives for command.
+void appendDescription(const PlanCommand& command, const NameTable& names, std::string& out);
+
+std::string describe(const PlanCommand& command, const NameTable& names);
+
+  // Append every command's description, one per line, to out. The text's
+  // length is worked out first, so out grows at most once.
+void formatCommands(const std::vector<PlanCommand>& commands, const NameTable& names, std::string& out);
+
+  // The binary form, all integers little-endian:
+  //
+  //   "GEPC"                  magic
+  //   u16 version (1), u16 flags (0)
+  //   u32 name count, u32 command count
+  //   names:    u32 byte length, then the UTF-8 bytes, for each name
+  //   commands: 12 bytes each: u8 type (PlanCommandType), u8 direction
+  //             (Direction), u16 zero, u32 name index, f32 distance (IEEE 754)
+  //
+  // Only the names the commands use are written, numbered by first use, so a
+  // NameTable shared by many plans doesn't bloat any one of them. Legs aren't
+  // marked; each but the last ends with its Deliver command.
+void encodePlan(const std::vector<PlanCommand>& commands, const NameTable& names, std::string& out);
+
+  // Read what encodePlan wrote, interning its names in names and appending its
+  // commands to commands. Returns false, changing neither, if data isn't a
+  // well-formed plan.
+bool decodePlan(const std::string& data, NameTable& names, std::vector<PlanCommand>& commands);
+
+#endif // PLANENCODING_INCLUDED
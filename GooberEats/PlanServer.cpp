@@ -0,0 +1,508 @@
+#include "PlanServer.h"
+#include "Json.h"
+#include "DeliveryFile.h"
+#include "LegCompiler.h"
+#include "PlanEncoding.h"
+#include "NearestDepot.h"
+#include "RadiusSearch.h"
+#include "WorkerPool.h"
+#include "Trace.h"
+#include <mutex>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+const size_t MAX_REQUEST_BYTES = 16 * 1024 * 1024;
+const int REPLY_MILES_DECIMALS = 4;
+
+PlanServer::PlanServer(const StreetMap* sm, const PlannerOptions& options)
+ : m_map(sm), m_options(options)
+{
+}
+
+struct PlanServer::Workspace
+{
+    RadiusSearch radius;
+
+    Workspace(const StreetMap* sm) : radius(sm) {}
+};
+
+  // "{"id":...," with the request's id, or null if it has none.
+static string startReply(const JsonValue* id)
+{
+    string reply = "{\"id\":";
+    if (id != nullptr && id->type() == JsonValue::JSON_STRING)
+        appendJsonString(reply, id->text());
+    else if (id != nullptr && id->type() == JsonValue::JSON_NUMBER)
+        reply += id->text();
+    else
+        reply += "null";
+    reply += ',';
+    return reply;
+}
+
+static string badRequest(const JsonValue* id, const string& error)
+{
+    string reply = startReply(id);
+    reply += "\"status\":\"bad_request\",\"error\":";
+    appendJsonString(reply, error);
+    reply += '}';
+    return reply;
+}
+
+static string failedReply(const JsonValue* id, DeliveryResult result)
+{
+    return startReply(id) + (result == BAD_COORD ? "\"status\":\"bad_coord\"}" : "\"status\":\"no_route\"}");
+}
+
+  // A {"lat": ..., "lon": ...} object as a GeoCoord. Each must be a string or
+  // number written the way a deliveries file would have it (GeoCoord throws
+  // on anything else).
+static bool readCoord(const JsonValue* v, GeoCoord& g)
+{
+    if (v == nullptr)
+        return false;
+    const JsonValue* lat = v->member("lat");
+    const JsonValue* lon = v->member("lon");
+    if (lat == nullptr || lon == nullptr ||
+        (lat->type() != JsonValue::JSON_STRING && lat->type() != JsonValue::JSON_NUMBER) ||
+        (lon->type() != JsonValue::JSON_STRING && lon->type() != JsonValue::JSON_NUMBER) ||
+        !isCoordinate(lat->text()) || !isCoordinate(lon->text()))
+        return false;
+    g = GeoCoord(lat->text(), lon->text());
+    return true;
+}
+
+  // With binary, the commands go as encodePlan's bytes in base64.
+static string okReply(const JsonValue* id, const vector<PlanCommand>& commands, const NameTable& names, double miles,
+                      bool binary)
+{
+    string reply = startReply(id);
+    reply += "\"status\":\"ok\",\"miles\":";
+    appendJsonNumber(reply, miles, REPLY_MILES_DECIMALS);
+    if (binary)
+    {
+        string data;
+        encodePlan(commands, names, data);
+        reply += ",\"encoding\":\"binary\",\"plan\":";
+        appendJsonBase64(reply, data);
+        reply += '}';
+        return reply;
+    }
+    reply += ",\"commands\":[";
+    for (int i = 0; i < commands.size(); i++)
+    {
+        const PlanCommand& command = commands[i];
+        if (i > 0)
+            reply += ',';
+        switch (command.type)
+        {
+          case PLAN_PROCEED:
+            reply += "{\"type\":\"proceed\",\"direction\":\"";
+            reply += directionName(static_cast<Direction>(command.direction));
+            reply += "\",\"street\":";
+            appendJsonString(reply, names.name(command.name));
+            reply += ",\"miles\":";
+            appendJsonNumber(reply, command.distance, REPLY_MILES_DECIMALS);
+            reply += '}';
+            break;
+          case PLAN_TURN:
+            reply += "{\"type\":\"turn\",\"direction\":\"";
+            reply += directionName(static_cast<Direction>(command.direction));
+            reply += "\",\"street\":";
+            appendJsonString(reply, names.name(command.name));
+            reply += '}';
+            break;
+          case PLAN_DELIVER:
+            reply += "{\"type\":\"deliver\",\"item\":";
+            appendJsonString(reply, names.name(command.name));
+            reply += '}';
+            break;
+        }
+    }
+    reply += "]}";
+    return reply;
+}
+
+static void appendRouteStats(string& out, const RouteStats& stats)
+{
+    out += "{\"searches\":" + to_string(stats.searches);
+    out += ",\"nodes_settled\":" + to_string(stats.nodesSettled);
+    out += ",\"edges_relaxed\":" + to_string(stats.edgesRelaxed);
+    out += ",\"heap_pushes\":" + to_string(stats.heapPushes);
+    out += ",\"heap_pops\":" + to_string(stats.heapPops);
+    out += ",\"hash_probes\":" + to_string(stats.hashProbes);
+    out += ",\"ms\":";
+    appendJsonNumber(out, stats.milliseconds, 3);
+    out += '}';
+}
+
+static void appendPlanStats(string& out, const PlanStats& stats)
+{
+    out += "{\"ms\":";
+    appendJsonNumber(out, stats.totalMilliseconds, 3);
+    out += ",\"optimize_ms\":";
+    appendJsonNumber(out, stats.optimizeMilliseconds, 3);
+    out += ",\"legs\":" + to_string(stats.legs);
+    out += ",\"legs_ms\":";
+    appendJsonNumber(out, stats.legMilliseconds, 3);
+    out += ",\"optimizer\":{\"annealing_moves\":" + to_string(stats.optimizer.annealingMoves);
+    out += ",\"acceptance_rate\":";
+    appendJsonNumber(out, stats.optimizer.acceptanceRate(), 4);
+    out += ",\"local_search_moves\":" + to_string(stats.optimizer.localSearchMoves);
+    out += ",\"ms\":";
+    appendJsonNumber(out, stats.optimizer.milliseconds, 3);
+    out += "},\"routing\":";
+    appendRouteStats(out, stats.routing);
+    out += '}';
+}
+
+  // reply with "stats": statsJson added at the end, if there are any.
+static string withStats(string reply, const string& statsJson)
+{
+    if (!statsJson.empty())
+        reply.insert(reply.size() - 1, ",\"stats\":" + statsJson);
+    return reply;
+}
+
+string PlanServer::handle(const string& request) const
+{
+    Workspace work(m_map);
+    return handle(request, work);
+}
+
+string PlanServer::handle(const string& request, Workspace& work) const
+{
+      // Whatever goes wrong with one request, the server has to keep going.
+    try
+    {
+        return respond(request, work);
+    }
+    catch (const exception& e)
+    {
+        return badRequest(nullptr, string("request failed: ") + e.what());
+    }
+    catch (...)
+    {
+        return badRequest(nullptr, "request failed");
+    }
+}
+
+string PlanServer::respond(const string& request, Workspace& work) const
+{
+    JsonValue req;
+    string error;
+    if (!parseJson(request, req, error))
+        return badRequest(nullptr, error);
+    if (req.type() != JsonValue::JSON_OBJECT)
+        return badRequest(nullptr, "request is not an object");
+    const JsonValue* id = req.member("id");
+    const JsonValue* type = req.member("type");
+    if (type == nullptr || type->type() != JsonValue::JSON_STRING)
+        return badRequest(id, "missing type");
+    TraceSpan span("request");
+    span.arg("type", type->text());
+
+    NameTable names;
+    vector<PlanCommand> commands;
+    double miles = 0;
+    const JsonValue* wantStats = req.member("stats");
+    bool counting = (wantStats != nullptr && wantStats->isTrue());
+    string statsJson;
+    const JsonValue* encoding = req.member("encoding");
+    bool binary = (encoding != nullptr && encoding->type() == JsonValue::JSON_STRING && encoding->text() == "binary");
+    if (encoding != nullptr && !binary &&
+        !(encoding->type() == JsonValue::JSON_STRING && encoding->text() == "json"))
+        return badRequest(id, "encoding must be \"json\" or \"binary\"");
+
+    if (type->text() == "route")
+    {
+        GeoCoord from;
+        GeoCoord to;
+        if (!readCoord(req.member("from"), from) || !readCoord(req.member("to"), to))
+            return badRequest(id, "route needs from and to coordinates");
+        CountingRouter router(m_map);
+        list<StreetSegment> route;
+        double totalDist;
+        RouteStats stats;
+        DeliveryResult result = router.generatePointToPointRoute(from, to, route, totalDist, (counting ? &stats : nullptr));
+        if (counting)
+            appendRouteStats(statsJson, stats);
+        if (result != DELIVERY_SUCCESS)
+            return withStats(failedReply(id, result), statsJson);
+        compileLeg(route, names, commands, miles);
+        return withStats(okReply(id, commands, names, miles, binary), statsJson);
+    }
+
+    if (type->text() == "plan")
+    {
+        GeoCoord depot;
+        if (!readCoord(req.member("depot"), depot))
+            return badRequest(id, "plan needs a depot coordinate");
+        const JsonValue* stops = req.member("deliveries");
+        if (stops == nullptr || stops->type() != JsonValue::JSON_ARRAY)
+            return badRequest(id, "plan needs a deliveries array");
+        vector<DeliveryRequest> deliveries;
+        for (int i = 0; i < stops->size(); i++)
+        {
+            GeoCoord location;
+            const JsonValue* item = (*stops)[i].member("item");
+            if (!readCoord(&(*stops)[i], location) || item == nullptr || item->type() != JsonValue::JSON_STRING)
+                return badRequest(id, "delivery " + to_string(i) + " needs lat, lon and item");
+            deliveries.push_back(DeliveryRequest(item->text(), location));
+        }
+
+        PlannerOptions options = m_options;
+        const JsonValue* road = req.member("road");
+        if (road != nullptr)
+            options.optimizer.metric = (road->isTrue() ? ROAD_DISTANCE : CROW_FLIES);
+        ConfigurableDeliveryPlanner planner(m_map, options);
+        auto keepLeg = [&commands, &miles](int /*leg*/, const vector<PlanCommand>& legCommands, double legMiles)
+        {
+            commands.insert(commands.end(), legCommands.begin(), legCommands.end());
+            miles += legMiles;
+        };
+        PlanStats stats;
+        DeliveryResult result = planner.streamDeliveryPlan(depot, deliveries, names, keepLeg, (counting ? &stats : nullptr));
+        if (counting)
+            appendPlanStats(statsJson, stats);
+        if (result != DELIVERY_SUCCESS)
+            return withStats(failedReply(id, result), statsJson);
+        return withStats(okReply(id, commands, names, miles, binary), statsJson);
+    }
+
+    if (type->text() == "assign")
+    {
+        const JsonValue* depotList = req.member("depots");
+        const JsonValue* stops = req.member("deliveries");
+        if (depotList == nullptr || depotList->type() != JsonValue::JSON_ARRAY || depotList->size() == 0 ||
+            stops == nullptr || stops->type() != JsonValue::JSON_ARRAY)
+            return badRequest(id, "assign needs depots and deliveries arrays");
+        vector<GeoCoord> depots(depotList->size());
+        for (int i = 0; i < depotList->size(); i++)
+        {
+            if (!readCoord(&(*depotList)[i], depots[i]))
+                return badRequest(id, "depot " + to_string(i) + " needs lat and lon");
+        }
+        vector<DeliveryRequest> deliveries;
+        for (int i = 0; i < stops->size(); i++)
+        {
+            GeoCoord location;
+            if (!readCoord(&(*stops)[i], location))
+                return badRequest(id, "delivery " + to_string(i) + " needs lat and lon");
+            deliveries.push_back(DeliveryRequest("", location));
+        }
+
+        NearestDepots nearest(m_map);
+        RouteStats stats;
+        DeliveryResult result = nearest.build(depots, (counting ? &stats : nullptr));
+        if (counting)
+            appendRouteStats(statsJson, stats);
+        if (result != DELIVERY_SUCCESS)
+            return withStats(failedReply(id, result), statsJson);
+        vector<int> depot;
+        vector<double> depotMiles;
+        nearest.assign(deliveries, depot, depotMiles);
+        string reply = startReply(id);
+        reply += "\"status\":\"ok\",\"assignments\":[";
+        for (int i = 0; i < depot.size(); i++)
+        {
+            if (i > 0)
+                reply += ',';
+            if (depot[i] < 0)
+            {
+                reply += "{\"depot\":null}";
+                continue;
+            }
+            reply += "{\"depot\":" + to_string(depot[i]) + ",\"miles\":";
+            appendJsonNumber(reply, depotMiles[i], REPLY_MILES_DECIMALS);
+            reply += '}';
+        }
+        reply += "]}";
+        return withStats(reply, statsJson);
+    }
+
+    if (type->text() == "within")
+    {
+        GeoCoord from;
+        if (!readCoord(req.member("from"), from))
+            return badRequest(id, "within needs a from coordinate");
+        const JsonValue* limit = req.member("miles");
+        double maxMiles = -1;
+        if (limit != nullptr && limit->type() == JsonValue::JSON_NUMBER)
+            maxMiles = strtod(limit->text().c_str(), nullptr); // no throw, unlike stod
+        if (!(maxMiles >= 0 && maxMiles < HUGE_VAL))
+            return badRequest(id, "within needs a finite miles number that isn't negative");
+        const JsonValue* stops = req.member("deliveries");
+        if (stops == nullptr || stops->type() != JsonValue::JSON_ARRAY)
+            return badRequest(id, "within needs a deliveries array");
+        vector<DeliveryRequest> deliveries;
+        for (int i = 0; i < stops->size(); i++)
+        {
+            GeoCoord location;
+            if (!readCoord(&(*stops)[i], location))
+                return badRequest(id, "delivery " + to_string(i) + " needs lat and lon");
+            deliveries.push_back(DeliveryRequest("", location));
+        }
+
+        vector<double> distances;
+        RouteStats stats;
+        DeliveryResult result = work.radius.within(from, maxMiles, deliveries, distances,
+                                                   (counting ? &stats : nullptr));
+        if (counting)
+            appendRouteStats(statsJson, stats);
+        if (result != DELIVERY_SUCCESS)
+            return withStats(failedReply(id, result), statsJson);
+        string reply = startReply(id);
+        reply += "\"status\":\"ok\",\"distances\":[";
+        for (int i = 0; i < distances.size(); i++)
+        {
+            if (i > 0)
+                reply += ',';
+            if (distances[i] < 0)
+                reply += "null";
+            else
+                appendJsonNumber(reply, distances[i], REPLY_MILES_DECIMALS);
+        }
+        reply += "]}";
+        return withStats(reply, statsJson);
+    }
+
+    return badRequest(id, "unknown type " + type->text());
+}
+
+void PlanServer::serveStream(istream& in, ostream& out, int threads) const
+{
+      // Each worker reads its own next line, so there's no queue to keep;
+      // replies go out as they're ready.
+    mutex inMutex;
+    mutex outMutex;
+    WorkerPool pool(threads);
+    pool.run(pool.size(), [&](int)
+    {
+        Workspace work(m_map);
+        string line;
+        while (true)
+        {
+            {
+                lock_guard<mutex> lock(inMutex);
+                if (!getline(in, line))
+                    return;
+            }
+            if (line.find_first_not_of(" \t\r") == string::npos)
+                continue; // blank lines get no reply
+            string reply = handle(line, work);
+            lock_guard<mutex> lock(outMutex);
+            out << reply << '\n';
+            out.flush();
+        }
+    });
+}
+
+static bool writeAll(int fd, const string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+  // Answer one connection's requests, in order, until it closes.
+void PlanServer::serveConnection(int fd, Workspace& work) const
+{
+    string buffer;
+    char chunk[65536];
+    size_t scanned = 0;
+    while (true)
+    {
+        size_t newline = buffer.find('\n', scanned);
+        if (newline == string::npos)
+        {
+            if (buffer.size() > MAX_REQUEST_BYTES)
+            {
+                writeAll(fd, badRequest(nullptr, "request too long") + "\n");
+                return;
+            }
+            scanned = buffer.size();
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            buffer.append(chunk, n);
+            continue;
+        }
+
+        string line = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        scanned = 0;
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        if (!writeAll(fd, handle(line, work) + "\n"))
+            return;
+    }
+}
+
+bool PlanServer::serveUnixSocket(const string& path, int threads) const
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "Socket path too long: " << path << endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+    unlink(path.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listener, SOMAXCONN) < 0)
+    {
+        cerr << "Unable to listen on " << path << ": " << strerror(errno) << endl;
+        close(listener);
+        return false;
+    }
+
+      // A client hanging up before its reply is written mustn't kill the
+      // server; the failed write just ends that connection.
+    signal(SIGPIPE, SIG_IGN);
+
+    WorkerPool pool(threads);
+    pool.run(pool.size(), [&](int)
+    {
+        Workspace work(m_map);
+        while (true)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                return;
+            }
+            serveConnection(client, work);
+            close(client);
+        }
+    });
+
+    cerr << "Stopped accepting connections on " << path << endl;
+    close(listener);
+    return false;
+}
@@ -0,0 +1,107 @@
+#ifndef PLANSERVER_INCLUDED
+#define PLANSERVER_INCLUDED
+
+#include "provided.h"
+#include "PlannerOptions.h"
+#include <string>
+#include <iostream>
+
+// A long-running planner: the map is loaded once and then serves any number
+// of requests. Requests and replies are JSON, one per line.
+//
+// Requests:
+//
+//   {"id": 7, "type": "plan", "road": true,
+//    "depot": {"lat": "34.0625329", "lon": "-118.4470263"},
+//    "deliveries": [{"lat": "34.0712323", "lon": "-118.4505969", "item": "Chicken tenders"}, ...]}
+//
+//   {"id": 8, "type": "route", "from": {"lat": ..., "lon": ...}, "to": {"lat": ..., "lon": ...}}
+//
+//   {"id": 9, "type": "assign", "depots": [{"lat": ..., "lon": ...}, ...],
+//    "deliveries": [{"lat": ..., "lon": ...}, ...]}
+//
+//   {"id": 10, "type": "within", "from": {"lat": ..., "lon": ...}, "miles": 1.5,
+//    "deliveries": [{"lat": ..., "lon": ...}, ...]}
+//
+// Coordinates are matched against the map's text, so give them as the map
+// writes them; strings and bare numbers both work, but one that isn't a plain
+// decimal (see isCoordinate() in DeliveryFile.h) makes a bad request. "road"
+// is optional and orders a plan's deliveries by driving distance. "id" is
+// optional and is echoed back, since replies can come back in a different
+// order from requests.
+// "stats": true, on any kind, adds a "stats" object to the reply with the
+// search counters and timings from PlanStats.h, even if the request fails.
+//
+// Replies:
+//
+//   {"id": 7, "status": "ok", "miles": 1.7818, "commands": [
+//       {"type": "proceed", "direction": "north", "street": "Broxton Avenue", "miles": 0.0782},
+//       {"type": "turn", "direction": "left", "street": "Le Conte Avenue"},
+//       {"type": "deliver", "item": "Chicken tenders"}, ...]}
+//
+// A route's reply has the same shape, without deliver commands. "encoding":
+// "binary", on a plan or route, replaces "commands" with "plan", the bytes of
+// the binary form in PlanEncoding.h as a base64 string, for clients that
+// decode that instead of JSON:
+//
+//   {"id": 7, "status": "ok", "miles": 1.7818, "encoding": "binary", "plan": "R0VQQwEAAAAG..."}
+//
+// An assign request finds the depot each delivery is the shortest drive from
+// (see NearestDepot.h); items are optional, and its reply lists, in the order
+// the deliveries were given, the index of that depot and the miles from it:
+//
+//   {"id": 9, "status": "ok", "assignments": [{"depot": 1, "miles": 0.8312},
+//       {"depot": null}, ...]}
+//
+// with a null depot for a delivery that isn't on the map or that no depot
+// can reach. A within request asks which deliveries are no more than "miles"
+// of driving from "from" (see RadiusSearch.h); its reply gives the miles to
+// each, in order, or null for one that's further:
+//
+//   {"id": 10, "status": "ok", "distances": [0.4486, null, ...]}
+//
+// A failed
+// request's status is "bad_coord", "no_route", or "bad_request"; a bad
+// request's reply also has an "error" message.
+
+class PlanServer
+{
+public:
+      // Requests are planned with options, apart from what they set for
+      // themselves. sm must be loaded already, and outlive the server.
+    PlanServer(const StreetMap* sm, const PlannerOptions& options = PlannerOptions());
+
+      // The reply to one request line, without a newline. Safe to call from
+      // several threads at once, and never throws. The serve functions keep
+      // one workspace per thread; this makes a fresh one for each call.
+    std::string handle(const std::string& request) const;
+
+      // Answer each line read from in with a line written to out, working on
+      // up to threads requests at once, until in ends.
+    void serveStream(std::istream& in, std::ostream& out, int threads) const;
+
+      // Listen on a Unix domain socket at path (replacing any file there) and
+      // answer requests on every connection, until the process is stopped.
+      // Up to threads connections are served at once, each one request at a
+      // time. Returns (false) only if the socket can't be set up or stops
+      // accepting connections.
+    bool serveUnixSocket(const std::string& path, int threads) const;
+
+      // We prevent a PlanServer object from being copied or assigned.
+    PlanServer(const PlanServer&) = delete;
+    PlanServer& operator=(const PlanServer&) = delete;
+
+private:
+      // What one serving thread keeps from request to request, so searches
+      // that reuse their work between queries (RadiusSearch) get to.
+    struct Workspace;
+
+    const StreetMap* m_map;
+    PlannerOptions m_options;
+
+    std::string handle(const std::string& request, Workspace& work) const;
+    std::string respond(const std::string& request, Workspace& work) const;
+    void serveConnection(int fd, Workspace& work) const;
+};
+
+#endif // PLANSERVER_INCLUDED
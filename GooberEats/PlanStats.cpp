@@ -0,0 +1,60 @@
+#include "PlanStats.h"
+#include <cstdio>
+using namespace std;
+
+void RouteStats::add(const RouteStats& other)
+{
+    searches += other.searches;
+    nodesSettled += other.nodesSettled;
+    edgesRelaxed += other.edgesRelaxed;
+    heapPushes += other.heapPushes;
+    heapPops += other.heapPops;
+    hashProbes += other.hashProbes;
+    milliseconds += other.milliseconds;
+}
+
+void OptimizerStats::add(const OptimizerStats& other)
+{
+    runs += other.runs;
+    annealingMoves += other.annealingMoves;
+    annealingAccepted += other.annealingAccepted;
+    localSearchMoves += other.localSearchMoves;
+    oldCrowMiles += other.oldCrowMiles;
+    newCrowMiles += other.newCrowMiles;
+    milliseconds += other.milliseconds;
+}
+
+void printRouteStats(const RouteStats& stats, ostream& out)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "Routing: %lld searches in %.2f ms; %lld nodes settled, %lld edges relaxed, "
+             "%lld heap pushes, %lld pops, %lld hash probes",
+             stats.searches, stats.milliseconds, stats.nodesSettled, stats.edgesRelaxed,
+             stats.heapPushes, stats.heapPops, stats.hashProbes);
+    out << line << endl;
+}
+
+void printOptimizerStats(const OptimizerStats& stats, ostream& out)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "Optimizer: %.2f ms; %lld annealing moves, %.1f%% accepted; %lld local search moves",
+             stats.milliseconds, stats.annealingMoves, 100 * stats.acceptanceRate(), stats.localSearchMoves);
+    out << line;
+    if (stats.oldCrowMiles > 0)
+    {
+          // Only optimizeDeliveryOrder measures the crow-flies miles.
+        snprintf(line, sizeof(line), "; crow-flies %.3f -> %.3f miles", stats.oldCrowMiles, stats.newCrowMiles);
+        out << line;
+    }
+    out << endl;
+}
+
+void printPlanStats(const PlanStats& stats, ostream& out)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "Plan: %.2f ms; ordering %.2f ms, %lld legs %.2f ms",
+             stats.totalMilliseconds, stats.optimizeMilliseconds, stats.legs, stats.legMilliseconds);
+    out << line << endl;
+    printOptimizerStats(stats.optimizer, out);
+    printRouteStats(stats.routing, out);
+}
@@ -0,0 +1,133 @@
+#ifndef PLANSTATS_INCLUDED
+#define PLANSTATS_INCLUDED
+
+#include "provided.h"
+#include <list>
+#include <ostream>
+
+// Counters for working out why a route or plan was slow. Functions that take
+// a stats pointer add to it when it isn't null, and skip even the counting
+// when it is: searches are templates on their counter type, and with counting
+// off they run with NoCount, whose increments compile to nothing. Stats add
+// up, so one object can total many calls; clear() starts over.
+
+  // A counter that counts nothing.
+struct NoCount
+{
+    void operator++(int) {}
+    void operator+=(long long) {}
+};
+
+  // What a shortest-path search counts as it goes, as long long or NoCount.
+template<typename Count>
+struct SearchCounts
+{
+    SearchCounts() : settled(), relaxed(), pushes(), pops(), probes() {}
+    Count settled;              // nodes taken off the queue for good
+    Count relaxed;              // edges looked along
+    Count pushes;
+    Count pops;                 // including stale entries skipped
+    Count probes;               // hash map keys compared
+};
+
+struct RouteStats
+{
+    RouteStats() { clear(); }
+
+    long long searches;
+    long long nodesSettled;
+    long long edgesRelaxed;
+    long long heapPushes;
+    long long heapPops;
+    long long hashProbes;
+    double milliseconds;        // time spent searching, summed over threads
+
+    void clear()
+    {
+        searches = nodesSettled = edgesRelaxed = heapPushes = heapPops = hashProbes = 0;
+        milliseconds = 0;
+    }
+    void add(const SearchCounts<long long>& counts)
+    {
+        searches++;
+        nodesSettled += counts.settled;
+        edgesRelaxed += counts.relaxed;
+        heapPushes += counts.pushes;
+        heapPops += counts.pops;
+        hashProbes += counts.probes;
+    }
+    void add(const RouteStats& other);
+};
+
+struct OptimizerStats
+{
+    OptimizerStats() { clear(); }
+
+    long long runs;             // calls to optimizeDeliveryOrder or optimizeTour
+    long long annealingMoves;   // moves proposed
+    long long annealingAccepted;
+    long long localSearchMoves; // improving moves applied
+    double oldCrowMiles;        // summed over optimizeDeliveryOrder runs
+    double newCrowMiles;
+    double milliseconds;
+
+    void clear()
+    {
+        runs = annealingMoves = annealingAccepted = localSearchMoves = 0;
+        oldCrowMiles = newCrowMiles = milliseconds = 0;
+    }
+    double acceptanceRate() const
+    {
+        return (annealingMoves > 0 ? static_cast<double>(annealingAccepted) / annealingMoves : 0);
+    }
+    void add(const OptimizerStats& other);
+};
+
+struct PlanStats
+{
+    PlanStats() { clear(); }
+
+    OptimizerStats optimizer;
+    RouteStats routing;         // leg routes, and road distance searches
+    long long legs;
+    double optimizeMilliseconds;    // ordering, including any road distances
+    double legMilliseconds;         // routing and compiling legs
+    double totalMilliseconds;
+
+    void clear()
+    {
+        optimizer.clear();
+        routing.clear();
+        legs = 0;
+        optimizeMilliseconds = legMilliseconds = totalMilliseconds = 0;
+    }
+};
+
+  // Prints stats a line at a time, for people.
+void printRouteStats(const RouteStats& stats, std::ostream& out);
+void printOptimizerStats(const OptimizerStats& stats, std::ostream& out);
+void printPlanStats(const PlanStats& stats, std::ostream& out);
+
+class PointToPointRouterImpl;
+
+  // PointToPointRouter, plus counting. provided.h can't change, so this is a
+  // class of its own rather than an overload there.
+class CountingRouter
+{
+public:
+    CountingRouter(const StreetMap* sm);
+    ~CountingRouter();
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::list<StreetSegment>& route,
+        double& totalDistanceTravelled,
+        RouteStats* stats) const;
+      // We prevent a CountingRouter object from being copied or assigned.
+    CountingRouter(const CountingRouter&) = delete;
+    CountingRouter& operator=(const CountingRouter&) = delete;
+private:
+    PointToPointRouterImpl* m_impl;
+};
+
+#endif // PLANSTATS_INCLUDED
@@ -0,0 +1,93 @@
+#ifndef PLANNEROPTIONS_INCLUDED
+#define PLANNEROPTIONS_INCLUDED
+
+#include "provided.h"
+#include "OptimizerOptions.h"
+#include "DeliveryPlan.h"
+#include "PlanCommand.h"
+#include "PlanStats.h"
+#include <vector>
+#include <functional>
+
+// Knobs for DeliveryPlanner. As with the optimizer, provided.h can't change, so
+// callers that need them use ConfigurableDeliveryPlanner below; plain
+// DeliveryPlanner runs with the defaults.
+
+struct PlannerOptions
+{
+    PlannerOptions()
+     : routingThreads(1)
+    {}
+
+      // How the delivery order is chosen. With optimizer.metric set to
+      // ROAD_DISTANCE, the planner computes the road distance matrix once and
+      // takes every leg's route from the searches that built it, so no leg is
+      // routed twice.
+    OptimizerOptions optimizer;
+
+      // Threads to route legs on once the order is fixed. Legs don't depend
+      // on each other, so with enough threads a plan takes about as long to
+      // route as its slowest leg. The threads are kept for the planner's
+      // lifetime. Legs taken from a road distance matrix are already routed,
+      // so this only matters with crow-flies ordering.
+    int routingThreads;
+};
+
+  // Receives one leg of a streamed plan: its index, its commands, and the
+  // miles it drives. Leg i ends with the Deliver command for the i-th stop
+  // made; the last leg drives back to the depot.
+typedef std::function<void(int leg, const std::vector<PlanCommand>& commands, double miles)> LegCallback;
+
+class DeliveryPlannerImpl;
+
+class ConfigurableDeliveryPlanner
+{
+public:
+    ConfigurableDeliveryPlanner(const StreetMap* sm, const PlannerOptions& options = PlannerOptions());
+    ~ConfigurableDeliveryPlanner();
+      // If stats isn't null, the work done is added to it, whether or not a
+      // plan is found.
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        std::vector<DeliveryCommand>& commands,
+        double& totalDistanceTravelled,
+        PlanStats* stats = nullptr) const;
+      // The same plan, kept leg by leg.
+    DeliveryResult generateDeliveryPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        DeliveryPlan& plan,
+        PlanStats* stats = nullptr) const;
+      // Add late orders to an existing plan. Each goes in where it adds the
+      // least crow-flies detour, and only the two legs either side of it are
+      // routed; the rest of the plan is left as it was, so the cost depends on
+      // the new orders, not on the size of the plan. Orders go in one at a
+      // time in the order given; if one fails with BAD_COORD or NO_ROUTE, the
+      // plan is left as it was, with none of them in it. plan must have a leg
+      // for each stop plus one back to the depot, as generateDeliveryPlan
+      // leaves it.
+    DeliveryResult insertDeliveries(DeliveryPlan& plan, const std::vector<DeliveryRequest>& newDeliveries) const;
+      // The same plan, handed to onLeg a leg at a time as soon as each leg
+      // and those before it are routed, so a driver can start on the first
+      // leg while the rest are still being worked out. onLeg is called in leg
+      // order and never twice at once, though with routingThreads > 1 it may
+      // be called on a pool thread. Names and items are interned in names,
+      // which must outlive any use of the commands. If a leg can't be routed,
+      // the legs before it have already been sent and the result is NO_ROUTE.
+    DeliveryResult streamDeliveryPlan(
+        const GeoCoord& depot,
+        const std::vector<DeliveryRequest>& deliveries,
+        NameTable& names,
+        const LegCallback& onLeg,
+        PlanStats* stats = nullptr) const;
+    const PlannerOptions& options() const;
+    void setOptions(const PlannerOptions& options);
+      // We prevent a ConfigurableDeliveryPlanner object from being copied or assigned.
+    ConfigurableDeliveryPlanner(const ConfigurableDeliveryPlanner&) = delete;
+    ConfigurableDeliveryPlanner& operator=(const ConfigurableDeliveryPlanner&) = delete;
+private:
+    DeliveryPlannerImpl* m_impl;
+};
+
+#endif // PLANNEROPTIONS_INCLUDED
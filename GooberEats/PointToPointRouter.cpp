@@ -3,7 +3,11 @@
 using namespace std;
 
 #include "ExpandableHashMap.h"
+#include "PlanStats.h"
+#include "Trace.h"
 #include <queue>
+#include <chrono>
+#include <functional>
 
 class PointToPointRouterImpl
 {
@@ -14,9 +18,17 @@ public:
         const GeoCoord& start,
         const GeoCoord& end,
         list<StreetSegment>& route,
-        double& totalDistanceTravelled) const;
+        double& totalDistanceTravelled,
+        RouteStats* stats = nullptr) const;
 private:
     const StreetMap* m_map;
+    template<typename Count>
+    DeliveryResult search(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled,
+        SearchCounts<Count>& counts) const;
 };
 
 PointToPointRouterImpl::PointToPointRouterImpl(const StreetMap* sm)
@@ -32,7 +44,37 @@ DeliveryResult PointToPointRouterImpl::generatePointToPointRoute(
         const GeoCoord& start,
         const GeoCoord& end,
         list<StreetSegment>& route,
-        double& totalDistanceTravelled) const
+        double& totalDistanceTravelled,
+        RouteStats* stats) const
+{
+    TraceSpan span("route");
+    DeliveryResult result;
+    if (stats == nullptr)
+    {
+        SearchCounts<NoCount> counts;
+        result = search(start, end, route, totalDistanceTravelled, counts);
+    }
+    else
+    {
+        SearchCounts<long long> counts;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        result = search(start, end, route, totalDistanceTravelled, counts);
+        stats->milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        stats->add(counts);
+    }
+    span.arg("segments", static_cast<long long>(route.size()));
+    span.arg("miles", totalDistanceTravelled);
+    return result;
+}
+
+  // A* from start to end, counting its work in counts.
+template<typename Count>
+DeliveryResult PointToPointRouterImpl::search(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled,
+        SearchCounts<Count>& counts) const
 {
 //    route.clear();
 //    totalDistanceTravelled = 0;
@@ -133,29 +175,34 @@ DeliveryResult PointToPointRouterImpl::generatePointToPointRoute(
 
     ExpandableHashMap<GeoCoord, GeoCoord> parentMap;
     ExpandableHashMap<GeoCoord, double> gValues;
-    ExpandableHashMap<GeoCoord, double> fValues;
 
-    struct compare // greater than comparator - so that we can sort priority_queue by f value
+      // Entries keep the f and g values they were pushed with, so the heap's
+      // order never changes under it. A node reached more cheaply later is
+      // pushed again, and the entry it leaves behind is skipped when popped.
+    struct QueueEntry
     {
-        ExpandableHashMap<GeoCoord, double>* m_fValues;
-        compare(ExpandableHashMap<GeoCoord, double>& fValues) { m_fValues = &fValues; }
-        bool operator()(const GeoCoord& l, const GeoCoord& r)
-        {
-            return (*(m_fValues->find(l)) > *(m_fValues->find(r)));
-        }
+        double f;
+        double g;
+        GeoCoord node;
+        bool operator>(const QueueEntry& other) const { return f > other.f; }
     };
-
-    compare comp(fValues);
-    priority_queue<GeoCoord, vector<GeoCoord>, compare> openSet(comp);
-    openSet.push(start);
-    fValues.associate(start, 0);
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    QueueEntry first = { distanceEarthMiles(start, end), 0, start };
+    openSet.push(first);
+    counts.pushes++;
     gValues.associate(start, 0);
 
     GeoCoord current;
 
     while (!openSet.empty())
     {
-        current = openSet.top();
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        counts.pops++;
+        if (top.g > *gValues.find(top.node, counts.probes))
+            continue; // stale
+        current = top.node;
+        counts.settled++;
         if (current == end) // reconstruct path
         {
 //            cerr << "Found path!" << endl;
@@ -186,34 +233,23 @@ DeliveryResult PointToPointRouterImpl::generatePointToPointRoute(
             return DELIVERY_SUCCESS;
         }
 
-        openSet.pop();
         vector<StreetSegment> segs;
         m_map->getSegmentsThatStartWith(current, segs);
         for (int i = 0; i < segs.size(); i++)
         {
+            counts.relaxed++;
             GeoCoord neighbor = segs[i].end;
-            double currentG = *gValues.find(current);
-            double tentativeG = currentG + distanceEarthMiles(current, neighbor);
+            double tentativeG = top.g + distanceEarthMiles(current, neighbor);
 
-            double* neighborG = gValues.find(neighbor);
-            if (neighborG != nullptr)
-            {
-                if (tentativeG < *neighborG)
-                {
-                    parentMap.associate(neighbor, current);
-                    gValues.associate(neighbor, tentativeG);
-                    double h = distanceEarthMiles(neighbor, end);
-                    fValues.associate(neighbor, tentativeG + h);
-                }
-            }
-            else
+            double* neighborG = gValues.find(neighbor, counts.probes);
+            if (neighborG == nullptr || tentativeG < *neighborG)
             {
                 parentMap.associate(neighbor, current);
                 gValues.associate(neighbor, tentativeG);
                 double h = distanceEarthMiles(neighbor, end);
-                fValues.associate(neighbor, tentativeG + h);
-
-                openSet.push(neighbor);
+                QueueEntry entry = { tentativeG + h, tentativeG, neighbor };
+                openSet.push(entry);
+                counts.pushes++;
             }
         }
     }
@@ -245,3 +281,25 @@ DeliveryResult PointToPointRouter::generatePointToPointRoute(
 {
     return m_impl->generatePointToPointRoute(start, end, route, totalDistanceTravelled);
 }
+
+//******************** CountingRouter functions *******************************
+
+CountingRouter::CountingRouter(const StreetMap* sm)
+{
+    m_impl = new PointToPointRouterImpl(sm);
+}
+
+CountingRouter::~CountingRouter()
+{
+    delete m_impl;
+}
+
+DeliveryResult CountingRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled,
+        RouteStats* stats) const
+{
+    return m_impl->generatePointToPointRoute(start, end, route, totalDistanceTravelled, stats);
+}
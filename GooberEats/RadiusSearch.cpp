@@ -0,0 +1,168 @@
+#include "RadiusSearch.h"
+#include "Trace.h"
+#include <queue>
+#include <limits>
+#include <chrono>
+#include <functional>
+using namespace std;
+
+namespace
+{
+    const double INF = numeric_limits<double>::infinity();
+
+    typedef pair<double, int> QueueEntry; // (miles from the source, node)
+}
+
+RadiusSearch::RadiusSearch(const StreetMap* sm)
+ : m_graph(sm)
+{
+}
+
+  // Undo the last search: only the entries it touched need clearing.
+void RadiusSearch::reset()
+{
+    for (int i = 0; i < m_touched.size(); i++)
+    {
+        m_miles[m_touched[i]] = INF;
+        m_settled[m_touched[i]] = 0;
+    }
+    m_touched.clear();
+    m_order.clear();
+}
+
+  // Nodes the graph has met since the arrays were last sized get entries too.
+void RadiusSearch::grow()
+{
+    if (m_miles.size() < m_graph.nodeCount())
+    {
+        m_miles.resize(m_graph.nodeCount(), INF);
+        m_settled.resize(m_graph.nodeCount(), 0);
+        m_isTarget.resize(m_graph.nodeCount(), 0);
+    }
+}
+
+  // Dijkstra from graph node `source`, settling nodes no further than maxMiles
+  // into m_order, until the `targets` nodes flagged in m_isTarget are all
+  // settled (never, if targets is 0 or less). Nodes past the cutoff are never
+  // pushed, so the heap only ever holds the area inside it.
+template<typename Count>
+void RadiusSearch::search(int source, double maxMiles, int targets, SearchCounts<Count>& counts)
+{
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    m_miles[source] = 0;
+    m_touched.push_back(source);
+    openSet.push(QueueEntry(0, source));
+    counts.pushes++;
+
+    while (!openSet.empty())
+    {
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        counts.pops++;
+        int current = top.second;
+        if (m_settled[current])
+            continue;
+        m_settled[current] = 1;
+        m_order.push_back(current);
+        counts.settled++;
+        if (m_isTarget[current] && --targets == 0)
+            return;
+
+        const vector<StreetGraph::Edge>& edges = m_graph.edgesFrom(current);
+        grow();
+        for (int i = 0; i < edges.size(); i++)
+        {
+            counts.relaxed++;
+            double tentative = top.first + edges[i].miles;
+            int neighbor = edges[i].to;
+            if (tentative <= maxMiles && tentative < m_miles[neighbor])
+            {
+                if (m_miles[neighbor] == INF)
+                    m_touched.push_back(neighbor);
+                m_miles[neighbor] = tentative;
+                openSet.push(QueueEntry(tentative, neighbor));
+                counts.pushes++;
+            }
+        }
+    }
+}
+
+void RadiusSearch::search(int source, double maxMiles, int targets, RouteStats* stats)
+{
+    TraceSpan span("radius search");
+    span.arg("miles", maxMiles);
+    if (stats == nullptr)
+    {
+        SearchCounts<NoCount> counts;
+        search(source, maxMiles, targets, counts);
+    }
+    else
+    {
+        SearchCounts<long long> counts;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        search(source, maxMiles, targets, counts);
+        stats->milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        stats->add(counts);
+    }
+    span.arg("settled", static_cast<long long>(m_order.size()));
+}
+
+DeliveryResult RadiusSearch::reachable(const GeoCoord& from, double maxMiles, vector<GeoCoord>& places,
+                                       vector<double>& miles, RouteStats* stats)
+{
+    places.clear();
+    miles.clear();
+    reset();
+    int source = m_graph.nodeFor(from);
+    if (source == -1)
+        return BAD_COORD;
+    grow();
+    search(source, maxMiles, 0, stats);
+    places.reserve(m_order.size());
+    miles.reserve(m_order.size());
+    for (int i = 0; i < m_order.size(); i++)
+    {
+        places.push_back(m_graph.coord(m_order[i]));
+        miles.push_back(m_miles[m_order[i]]);
+    }
+    return DELIVERY_SUCCESS;
+}
+
+DeliveryResult RadiusSearch::within(const GeoCoord& from, double maxMiles, const vector<DeliveryRequest>& targets,
+                                    vector<double>& miles, RouteStats* stats)
+{
+    miles.assign(targets.size(), -1);
+    reset();
+    int source = m_graph.nodeFor(from);
+    if (source == -1)
+        return BAD_COORD;
+
+    vector<int> targetNode(targets.size());
+    for (int i = 0; i < targets.size(); i++)
+        targetNode[i] = m_graph.nodeFor(targets[i].location);
+    grow();
+
+      // Targets can share a location, so count distinct nodes to wait for.
+    int distinct = 0;
+    for (int i = 0; i < targets.size(); i++)
+    {
+        if (targetNode[i] != -1 && !m_isTarget[targetNode[i]])
+        {
+            m_isTarget[targetNode[i]] = 1;
+            distinct++;
+        }
+    }
+    if (distinct > 0)
+        search(source, maxMiles, distinct, stats);
+
+    for (int i = 0; i < targets.size(); i++)
+    {
+        int node = targetNode[i];
+        if (node == -1)
+            continue;
+        if (m_settled[node])
+            miles[i] = m_miles[node];
+        m_isTarget[node] = 0;
+    }
+    return DELIVERY_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#ifndef RADIUSSEARCH_INCLUDED
+#define RADIUSSEARCH_INCLUDED
+
+#include "provided.h"
+#include "StreetGraph.h"
+#include "PlanStats.h"
+#include <vector>
+
+// Everything within a driving distance of a place (an isochrone). Each query
+// is a Dijkstra search that stops at the cutoff, so it only touches the area
+// inside it. A RadiusSearch keeps its graph and its search arrays between
+// queries, and only resets the entries the last query touched, so asking
+// again and again, as a dispatcher does, costs the area explored each time
+// and not the size of the map.
+//
+// Not thread-safe, like the StreetGraph it keeps.
+
+class RadiusSearch
+{
+public:
+    RadiusSearch(const StreetMap* sm);
+
+      // Every place within maxMiles of from, nearest first, and its miles.
+      // Returns BAD_COORD if from isn't on the map.
+    DeliveryResult reachable(const GeoCoord& from, double maxMiles, std::vector<GeoCoord>& places,
+                             std::vector<double>& miles, RouteStats* stats = nullptr);
+
+      // The miles from from to each target, or -1 for a target further than
+      // maxMiles, unreachable, or not on the map. Stops early once every
+      // target is found. Returns BAD_COORD if from isn't on the map.
+    DeliveryResult within(const GeoCoord& from, double maxMiles, const std::vector<DeliveryRequest>& targets,
+                          std::vector<double>& miles, RouteStats* stats = nullptr);
+
+      // We prevent a RadiusSearch object from being copied or assigned.
+    RadiusSearch(const RadiusSearch&) = delete;
+    RadiusSearch& operator=(const RadiusSearch&) = delete;
+
+private:
+    StreetGraph m_graph;
+    std::vector<double> m_miles;        // by graph node; infinity if unreached
+    std::vector<char> m_settled;
+    std::vector<char> m_isTarget;
+    std::vector<int> m_touched;         // nodes the last search set m_miles for
+    std::vector<int> m_order;           // nodes the last search settled, in order
+
+    void reset();
+    void grow();
+    template<typename Count>
+    void search(int source, double maxMiles, int targets, SearchCounts<Count>& counts);
+    void search(int source, double maxMiles, int targets, RouteStats* stats);
+};
+
+#endif // RADIUSSEARCH_INCLUDED
@@ -0,0 +1,117 @@
+#include "ReferenceRouter.h"
+#include <map>
+#include <queue>
+#include <functional>
+using namespace std;
+
+ReferenceRouter::ReferenceRouter(const StreetMap* sm)
+ : m_map(sm)
+{
+}
+
+DeliveryResult ReferenceRouter::generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        list<StreetSegment>& route,
+        double& totalDistanceTravelled) const
+{
+    route.clear();
+    totalDistanceTravelled = 0;
+    vector<StreetSegment> segs;
+    if (!m_map->getSegmentsThatStartWith(start, segs) || !m_map->getSegmentsThatStartWith(end, segs))
+        return BAD_COORD;
+
+    typedef pair<double, GeoCoord> QueueEntry;
+    map<GeoCoord, double> dist;
+    map<GeoCoord, StreetSegment> via;   // the segment each node was reached by
+    map<GeoCoord, bool> done;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    dist[start] = 0;
+    openSet.push(QueueEntry(0, start));
+
+    while (!openSet.empty())
+    {
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        const GeoCoord& current = top.second;
+        if (done[current])
+            continue;
+        done[current] = true;
+        if (current == end)
+        {
+            totalDistanceTravelled = top.first;
+            for (GeoCoord at = end; at != start; at = via[at].start)
+                route.push_front(via[at]);
+            return DELIVERY_SUCCESS;
+        }
+
+        segs.clear();
+        m_map->getSegmentsThatStartWith(current, segs);
+        for (int i = 0; i < segs.size(); i++)
+        {
+            double tentative = top.first + distanceEarthMiles(segs[i].start, segs[i].end);
+            map<GeoCoord, double>::iterator it = dist.find(segs[i].end);
+            if (it == dist.end() || tentative < it->second)
+            {
+                dist[segs[i].end] = tentative;
+                via[segs[i].end] = segs[i];
+                openSet.push(QueueEntry(tentative, segs[i].end));
+            }
+        }
+    }
+    return NO_ROUTE;
+}
+
+DeliveryResult ReferenceRouter::milesFrom(const GeoCoord& start, map<GeoCoord, double>& miles) const
+{
+    miles.clear();
+    vector<StreetSegment> segs;
+    if (!m_map->getSegmentsThatStartWith(start, segs))
+        return BAD_COORD;
+
+    typedef pair<double, GeoCoord> QueueEntry;
+    map<GeoCoord, double> dist;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    dist[start] = 0;
+    openSet.push(QueueEntry(0, start));
+
+    while (!openSet.empty())
+    {
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        const GeoCoord& current = top.second;
+        if (miles.find(current) != miles.end())
+            continue;
+        miles[current] = top.first;
+
+        segs.clear();
+        m_map->getSegmentsThatStartWith(current, segs);
+        for (int i = 0; i < segs.size(); i++)
+        {
+            double tentative = top.first + distanceEarthMiles(segs[i].start, segs[i].end);
+            map<GeoCoord, double>::iterator it = dist.find(segs[i].end);
+            if (it == dist.end() || tentative < it->second)
+            {
+                dist[segs[i].end] = tentative;
+                openSet.push(QueueEntry(tentative, segs[i].end));
+            }
+        }
+    }
+    return DELIVERY_SUCCESS;
+}
+
+double routeLength(const list<StreetSegment>& route, const GeoCoord& start, const GeoCoord& end)
+{
+    if (route.empty())
+        return (start == end ? 0 : -1);
+    double miles = 0;
+    GeoCoord at = start;
+    for (list<StreetSegment>::const_iterator it = route.begin(); it != route.end(); it++)
+    {
+        if (it->start != at)
+            return -1;
+        miles += distanceEarthMiles(it->start, it->end);
+        at = it->end;
+    }
+    return (at == end ? miles : -1);
+}
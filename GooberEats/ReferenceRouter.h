@@ -0,0 +1,41 @@
+#ifndef REFERENCEROUTER_INCLUDED
+#define REFERENCEROUTER_INCLUDED
+
+#include "provided.h"
+#include <list>
+#include <map>
+
+// Textbook Dijkstra straight over the StreetMap, for checking faster routers
+// against. It's written to be obviously right rather than quick: std::map for
+// its bookkeeping (so it shares no code with ExpandableHashMap or StreetGraph),
+// a fresh search every time, and no heuristic. Use it to test, not to plan.
+
+class ReferenceRouter
+{
+public:
+    ReferenceRouter(const StreetMap* sm);
+
+      // The same contract as PointToPointRouter: BAD_COORD if either end has
+      // no segments, NO_ROUTE if end can't be reached, and otherwise a
+      // shortest route and its length.
+    DeliveryResult generatePointToPointRoute(
+        const GeoCoord& start,
+        const GeoCoord& end,
+        std::list<StreetSegment>& route,
+        double& totalDistanceTravelled) const;
+
+      // One search from start that runs until every node it can reach is
+      // settled, leaving each one's shortest miles in miles, so many routes
+      // from the same start can be checked for the cost of one. BAD_COORD if
+      // start has no segments.
+    DeliveryResult milesFrom(const GeoCoord& start, std::map<GeoCoord, double>& miles) const;
+
+private:
+    const StreetMap* m_map;
+};
+
+  // Sum of the lengths of route's segments, or -1 if it isn't a connected
+  // path from start to end (an empty route is one only when start == end).
+double routeLength(const std::list<StreetSegment>& route, const GeoCoord& start, const GeoCoord& end);
+
+#endif // REFERENCEROUTER_INCLUDED
@@ -0,0 +1,204 @@
+#include "RoadMatrix.h"
+#include <queue>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <chrono>
+#include "Trace.h"
+using namespace std;
+
+namespace
+{
+    const double INF = numeric_limits<double>::infinity();
+
+      // Matrix entries this close are treated as equal when deciding whether
+      // the matrix is symmetric (the two directions are summed in different
+      // orders, so they can differ in the last bits).
+    const double SYMMETRY_TOLERANCE = 1e-9;
+
+    typedef pair<double, int> QueueEntry; // (miles from the source, node)
+}
+
+RoadMatrix::RoadMatrix(const StreetMap* sm)
+ : m_graph(sm)
+{
+}
+
+  // Dijkstra from graph node `source` until the `targets` nodes flagged in
+  // isTarget are all settled. Nodes first seen during this search get ids past
+  // the end of tree's arrays, so the arrays grow to match.
+template<typename Count>
+bool RoadMatrix::search(int source, const vector<char>& isTarget, int targets, Tree& tree, SearchCounts<Count>& counts)
+{
+    tree.dist.assign(m_graph.nodeCount(), INF);
+    tree.parent.assign(m_graph.nodeCount(), -1);
+    tree.parentEdge.assign(m_graph.nodeCount(), -1);
+    vector<char> settled(m_graph.nodeCount(), 0);
+
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > openSet;
+    tree.dist[source] = 0;
+    openSet.push(QueueEntry(0, source));
+    counts.pushes++;
+
+    while (!openSet.empty() && targets > 0)
+    {
+        QueueEntry top = openSet.top();
+        openSet.pop();
+        counts.pops++;
+        int current = top.second;
+        if (settled[current])
+            continue;
+        settled[current] = 1;
+        counts.settled++;
+        if (current < isTarget.size() && isTarget[current])
+            targets--;
+
+        const vector<StreetGraph::Edge>& edges = m_graph.edgesFrom(current);
+        if (tree.dist.size() < m_graph.nodeCount())
+        {
+            tree.dist.resize(m_graph.nodeCount(), INF);
+            tree.parent.resize(m_graph.nodeCount(), -1);
+            tree.parentEdge.resize(m_graph.nodeCount(), -1);
+            settled.resize(m_graph.nodeCount(), 0);
+        }
+        for (int i = 0; i < edges.size(); i++)
+        {
+            counts.relaxed++;
+            double tentative = top.first + edges[i].miles;
+            int neighbor = edges[i].to;
+            if (tentative < tree.dist[neighbor])
+            {
+                tree.dist[neighbor] = tentative;
+                tree.parent[neighbor] = current;
+                tree.parentEdge[neighbor] = i;
+                openSet.push(QueueEntry(tentative, neighbor));
+                counts.pushes++;
+            }
+        }
+    }
+    return targets == 0;
+}
+
+bool RoadMatrix::search(int source, const vector<char>& isTarget, int targets, Tree& tree, RouteStats* stats)
+{
+    if (stats == nullptr)
+    {
+        SearchCounts<NoCount> counts;
+        return search(source, isTarget, targets, tree, counts);
+    }
+    SearchCounts<long long> counts;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool found = search(source, isTarget, targets, tree, counts);
+    stats->milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    stats->add(counts);
+    return found;
+}
+
+  // Find the graph node of the depot and every delivery, and flag them as
+  // targets. BAD_COORD if one isn't on the map.
+DeliveryResult RoadMatrix::findStops(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries,
+                                     vector<char>& isTarget, int& targets)
+{
+    int n = static_cast<int>(deliveries.size()) + 1;
+    m_stopNode.assign(n, -1);
+    for (int i = 0; i < n; i++)
+    {
+        const GeoCoord& g = (i == 0 ? depot : deliveries[i - 1].location);
+        m_stopNode[i] = m_graph.nodeFor(g);
+        if (m_stopNode[i] == -1)
+        {
+            cerr << "Bad coordinate!" << endl;
+            return BAD_COORD;
+        }
+    }
+
+      // Stops can share a location, so count distinct nodes to wait for.
+    isTarget.assign(m_graph.nodeCount(), 0);
+    targets = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!isTarget[m_stopNode[i]])
+        {
+            isTarget[m_stopNode[i]] = 1;
+            targets++;
+        }
+    }
+    return DELIVERY_SUCCESS;
+}
+
+DeliveryResult RoadMatrix::build(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries, RouteStats* stats)
+{
+    TraceSpan span("road distances");
+    span.arg("stops", static_cast<long long>(deliveries.size()));
+    int n = static_cast<int>(deliveries.size()) + 1;
+    vector<char> isTarget;
+    int targets;
+    DeliveryResult found = findStops(depot, deliveries, isTarget, targets);
+    if (found != DELIVERY_SUCCESS)
+        return found;
+
+    m_trees.assign(n, Tree());
+    vector<double> miles(static_cast<size_t>(n) * n);
+    for (int from = 0; from < n; from++)
+    {
+        if (!search(m_stopNode[from], isTarget, targets, m_trees[from], stats))
+            return NO_ROUTE;
+        for (int to = 0; to < n; to++)
+            miles[static_cast<size_t>(from) * n + to] = m_trees[from].dist[m_stopNode[to]];
+    }
+
+    bool symmetric = true;
+    for (int from = 0; from < n && symmetric; from++)
+        for (int to = from + 1; to < n; to++)
+        {
+            double there = miles[static_cast<size_t>(from) * n + to];
+            double back = miles[static_cast<size_t>(to) * n + from];
+            if (fabs(there - back) > SYMMETRY_TOLERANCE * max(1.0, there))
+            {
+                symmetric = false;
+                break;
+            }
+        }
+
+    m_d.resize(n, symmetric);
+    for (int from = 0; from < n; from++)
+        for (int to = 0; to < n; to++)
+            m_d.set(from, to, miles[static_cast<size_t>(from) * n + to]);
+    return DELIVERY_SUCCESS;
+}
+
+DeliveryResult RoadMatrix::buildFrom(const GeoCoord& depot, const vector<DeliveryRequest>& deliveries,
+                                     vector<double>& miles, RouteStats* stats)
+{
+    TraceSpan span("road distances from depot");
+    span.arg("stops", static_cast<long long>(deliveries.size()));
+    int n = static_cast<int>(deliveries.size()) + 1;
+    vector<char> isTarget;
+    int targets;
+    DeliveryResult found = findStops(depot, deliveries, isTarget, targets);
+    if (found != DELIVERY_SUCCESS)
+        return found;
+
+    m_trees.assign(1, Tree());
+    search(m_stopNode[0], isTarget, targets, m_trees[0], stats);
+    m_d.resize(0, false);
+    miles.resize(deliveries.size());
+    for (int i = 1; i < n; i++)
+        miles[i - 1] = m_trees[0].dist[m_stopNode[i]];
+    return DELIVERY_SUCCESS;
+}
+
+void RoadMatrix::route(int from, int to, list<StreetSegment>& route, double& totalDistanceTravelled) const
+{
+    route.clear();
+    const Tree& tree = m_trees[from];
+    int source = m_stopNode[from];
+    int node = m_stopNode[to];
+    totalDistanceTravelled = tree.dist[node];
+    while (node != source)
+    {
+        int parent = tree.parent[node];
+        route.push_front(m_graph.segment(parent, tree.parentEdge[node]));
+        node = parent;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef ROADMATRIX_INCLUDED
+#define ROADMATRIX_INCLUDED
+
+#include "provided.h"
+#include "DistanceMatrix.h"
+#include "StreetGraph.h"
+#include "PlanStats.h"
+#include <vector>
+#include <list>
+
+// Driving distances between the depot and every delivery, in the same node
+// numbering as DistanceMatrix. Each node gets one Dijkstra search that stops
+// once every other stop is settled, and its shortest-path tree is kept, so
+// route() can hand back the route for any leg without searching again.
+//
+// Memory is one tree per stop over the part of the map the searches reached,
+// so this is meant for batches a planner routes, not thousands of stops.
+
+class RoadMatrix
+{
+public:
+    RoadMatrix(const StreetMap* sm);
+
+      // Search from every stop. Returns BAD_COORD if the depot or a delivery
+      // isn't on the map, and NO_ROUTE if some stop can't reach another. If
+      // stats isn't null, the searches are counted into it.
+    DeliveryResult build(const GeoCoord& depot, const std::vector<DeliveryRequest>& deliveries,
+                         RouteStats* stats = nullptr);
+
+      // Search from the depot alone, for routing one place to many: miles[i]
+      // is the drive to deliveries[i], or infinite if the depot can't reach
+      // it. Afterwards distances() is empty and route() only works from node
+      // 0 to a delivery it can reach. Returns BAD_COORD if the depot or a
+      // delivery isn't on the map.
+    DeliveryResult buildFrom(const GeoCoord& depot, const std::vector<DeliveryRequest>& deliveries,
+                             std::vector<double>& miles, RouteStats* stats = nullptr);
+
+    const DistanceMatrix& distances() const { return m_d; }
+
+      // Shortest route from node `from` to node `to`; empty if they're at the
+      // same place. Only valid after build() succeeds.
+    void route(int from, int to, std::list<StreetSegment>& route, double& totalDistanceTravelled) const;
+
+private:
+    struct Tree
+    {
+        std::vector<double> dist;       // miles from the source, by graph node
+        std::vector<int> parent;        // previous node on the way, or -1
+        std::vector<int> parentEdge;    // which of parent's edges leads here
+    };
+
+    StreetGraph m_graph;
+    std::vector<int> m_stopNode;        // graph node of each matrix node
+    std::vector<Tree> m_trees;          // m_trees[i] is rooted at matrix node i
+    DistanceMatrix m_d;
+
+    DeliveryResult findStops(const GeoCoord& depot, const std::vector<DeliveryRequest>& deliveries,
+                             std::vector<char>& isTarget, int& targets);
+    template<typename Count>
+    bool search(int source, const std::vector<char>& isTarget, int targets, Tree& tree, SearchCounts<Count>& counts);
+    bool search(int source, const std::vector<char>& isTarget, int targets, Tree& tree, RouteStats* stats);
+};
+
+#endif // ROADMATRIX_INCLUDED
@@ -0,0 +1,83 @@
+#include "StreetGraph.h"
+using namespace std;
+
+StreetGraph::StreetGraph(const StreetMap* sm)
+ : m_map(sm)
+{
+}
+
+int StreetGraph::intern(const GeoCoord& g)
+{
+    const int* id = m_ids.find(g);
+    if (id != nullptr)
+        return *id;
+    int node = static_cast<int>(m_nodes.size());
+    m_ids.associate(g, node);
+    Node n;
+    n.coord = g;
+    n.expanded = false;
+    m_nodes.push_back(n);
+    return node;
+}
+
+void StreetGraph::expand(int node)
+{
+    if (m_nodes[node].expanded)
+        return;
+    vector<StreetSegment> segs;
+    m_map->getSegmentsThatStartWith(m_nodes[node].coord, segs);
+    vector<Edge> edges(segs.size());
+    for (int i = 0; i < segs.size(); i++)
+    {
+        edges[i].to = intern(segs[i].end); // may reallocate m_nodes
+        edges[i].miles = distanceEarthMiles(segs[i].start, segs[i].end);
+    }
+    Node& n = m_nodes[node];
+    n.segments.swap(segs);
+    n.edges.swap(edges);
+    n.expanded = true;
+}
+
+int StreetGraph::nodeFor(const GeoCoord& g)
+{
+    const int* id = m_ids.find(g);
+    if (id != nullptr)
+        return *id;
+    vector<StreetSegment> segs;
+    if (!m_map->getSegmentsThatStartWith(g, segs))
+        return -1;
+    return intern(g);
+}
+
+const vector<StreetGraph::Edge>& StreetGraph::edgesFrom(int node)
+{
+    expand(node);
+    return m_nodes[node].edges;
+}
+
+const vector<StreetSegment>& StreetGraph::segmentsFrom(int node)
+{
+    expand(node);
+    return m_nodes[node].segments;
+}
+
+void StreetGraph::reachableFrom(int node, vector<int>& nodes)
+{
+    nodes.assign(1, node);
+    vector<char> seen(m_nodes.size(), 0);
+    seen[node] = 1;
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        const vector<Edge>& edges = edgesFrom(nodes[i]);
+        seen.resize(m_nodes.size(), 0); // the edges may have found new nodes
+        for (int e = 0; e < edges.size(); e++)
+        {
+            int to = edges[e].to;
+            if (!seen[to])
+            {
+                seen[to] = 1;
+                nodes.push_back(to);
+            }
+        }
+    }
+}
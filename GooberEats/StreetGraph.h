@@ -0,0 +1,74 @@
+#ifndef STREETGRAPH_INCLUDED
+#define STREETGRAPH_INCLUDED
+
+#include "provided.h"
+#include "ExpandableHashMap.h"
+#include <vector>
+
+// The street map as a graph with dense integer node ids, for searches that
+// visit many nodes or search many times. Coordinates get an id the first time
+// they are seen, and a node's outgoing segments are fetched from the StreetMap
+// the first time they're asked for and kept, so repeated searches over the same
+// area don't copy the same segments out of the map again.
+//
+// Not thread-safe: a StreetGraph grows as it's searched, so each thread needs
+// its own.
+
+class StreetGraph
+{
+public:
+    struct Edge
+    {
+        int to;
+        double miles;
+    };
+
+    StreetGraph(const StreetMap* sm);
+
+      // Id of the node at g, or -1 if no segment starts there.
+    int nodeFor(const GeoCoord& g);
+
+      // Id of the node at g if the graph has met it already, or -1. Unlike
+      // nodeFor(), never looks in the map, so it's safe to share.
+    int knownNode(const GeoCoord& g) const
+    {
+        const int* id = m_ids.find(g);
+        return (id != nullptr ? *id : -1);
+    }
+
+    int nodeCount() const { return static_cast<int>(m_nodes.size()); }
+    const GeoCoord& coord(int node) const { return m_nodes[node].coord; }
+
+      // Segments leaving node, and the matching edges (edge i is segment i).
+    const std::vector<Edge>& edgesFrom(int node);
+    const std::vector<StreetSegment>& segmentsFrom(int node);
+
+      // Segment for edge i of a node whose edges have already been fetched.
+    const StreetSegment& segment(int node, int i) const { return m_nodes[node].segments[i]; }
+
+      // Every node that can be driven to from node, node first, in
+      // breadth-first order. Fetches the edges of the whole component.
+    void reachableFrom(int node, std::vector<int>& nodes);
+
+      // We prevent a StreetGraph object from being copied or assigned.
+    StreetGraph(const StreetGraph&) = delete;
+    StreetGraph& operator=(const StreetGraph&) = delete;
+
+private:
+    struct Node
+    {
+        GeoCoord coord;
+        bool expanded;
+        std::vector<StreetSegment> segments;
+        std::vector<Edge> edges;
+    };
+
+    const StreetMap* m_map;
+    ExpandableHashMap<GeoCoord, int> m_ids;
+    std::vector<Node> m_nodes;
+
+    int intern(const GeoCoord& g);
+    void expand(int node);
+};
+
+#endif // STREETGRAPH_INCLUDED
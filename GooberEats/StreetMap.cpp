@@ -6,14 +6,24 @@ using namespace std;
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <cmath>
 
 #include "ExpandableHashMap.h" // ahh
+#include "StreetMapTiles.h"
+#include "Trace.h"
 
 unsigned int hasher(const GeoCoord& g)
 {
     return std::hash<string>()(g.latitudeText + g.longitudeText);
 }
 
+unsigned int hasher(const long long& k)
+{
+    return std::hash<long long>()(k);
+}
+
 class StreetMapImpl
 {
 public:
@@ -22,38 +32,104 @@ public:
     bool load(string mapFile);
     bool getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSegment>& segs) const;
 private:
-    ExpandableHashMap<GeoCoord, vector<StreetSegment>> m_map;
+    typedef ExpandableHashMap<GeoCoord, vector<StreetSegment>> SegmentMap;
+    SegmentMap m_map;
+
+    // Tiled mode: m_map stays empty and segments come from m_tiles instead.
+    struct Tile
+    {
+        long long offset;
+        long long length;
+        SegmentMap* segments;             // nullptr while not resident
+        list<long long>::iterator lruPos; // position in m_residentTiles
+    };
+    bool m_tiled;
+    double m_tileDegrees;
+    int m_maxResidentTiles;
+    mutable ifstream m_tileFile;
+    streamoff m_tileDataStart;
+    mutable ExpandableHashMap<long long, Tile> m_tiles;
+    mutable list<long long> m_residentTiles; // most recently used first
+    mutable mutex m_tileMutex;
+
+    bool loadTiled(ifstream& infile);
+    const SegmentMap* residentTile(long long key) const;
 };
 
+static void addSegment(ExpandableHashMap<GeoCoord, vector<StreetSegment>>& m, const GeoCoord& start, const GeoCoord& end, const string& name)
+{
+    vector<StreetSegment>* val = m.find(start);
+    if (val != nullptr)
+    {
+        val->push_back(StreetSegment(start, end, name));
+    }
+    else
+    {
+        vector<StreetSegment> seg;
+        seg.push_back(StreetSegment(start, end, name));
+        m.associate(start, seg);
+    }
+}
+
+  // The key a tile is filed under, from its row and column. The row is
+  // shifted as unsigned, since shifting a negative number (any tile south of
+  // the equator) left is undefined.
+static long long tileKey(long long latIndex, long long lonIndex)
+{
+    return static_cast<long long>((static_cast<unsigned long long>(latIndex) << 32) ^
+                                  (static_cast<unsigned long long>(lonIndex) & 0xffffffffULL));
+}
+
+static long long tileKey(double lat, double lon, double tileDegrees)
+{
+    return tileKey(static_cast<long long>(floor(lat / tileDegrees)), static_cast<long long>(floor(lon / tileDegrees)));
+}
+
 StreetMapImpl::StreetMapImpl()
+ : m_tiled(false), m_tileDegrees(DEFAULT_TILE_DEGREES), m_maxResidentTiles(DEFAULT_MAX_RESIDENT_TILES), m_tileDataStart(0)
 {
 }
 
 StreetMapImpl::~StreetMapImpl()
 {
+    list<long long>::iterator it = m_residentTiles.begin();
+    while (it != m_residentTiles.end())
+    {
+        delete m_tiles.find(*it)->segments;
+        it++;
+    }
 }
 
 bool StreetMapImpl::load(string mapFile)
 {
+    TraceSpan span("load map");
+    span.arg("file", mapFile);
     ifstream infile(mapFile);
     if ( ! infile )                // Did opening the file fail?
     {
         cerr << "Error: Cannot open mapdata.txt!" << endl;
         return false;
     }
-    
+
+    string firstLine;
+    getline(infile, firstLine);
+    if (firstLine == TILED_MAP_MAGIC)
+        return loadTiled(infile);
+    infile.clear();
+    infile.seekg(0);
+
     string address;
     int count;
     string startLat;
     string startLong;
     string endLat;
     string endLong;
-    
+
     while (infile)
     {
         getline(infile, address);
         infile >> count;
-        
+
         infile.ignore(10000, '\n');
         for (int i = 0; i < count; i++)
         {
@@ -61,41 +137,116 @@ bool StreetMapImpl::load(string mapFile)
             infile >> startLong;
             infile >> endLat;
             infile >> endLong;
-            
+
             GeoCoord start(startLat, startLong);
             GeoCoord end(endLat, endLong);
-            
-            vector<StreetSegment>* startVal = m_map.find(start);
-            if (startVal != nullptr)
-            {
-                startVal->push_back(StreetSegment(start, end, address));
-            }
-            else
-            {
-                vector<StreetSegment> seg;
-                seg.push_back(StreetSegment(start, end, address));
-                m_map.associate(start, seg);
-            }
-            
-            vector<StreetSegment>* endVal = m_map.find(end);
-            if (endVal != nullptr)
-            {
-                endVal->push_back(StreetSegment(end, start, address));
-            }
-            else
-            {
-                vector<StreetSegment> seg;
-                seg.push_back(StreetSegment(end, start, address));
-                m_map.associate(end, seg);
-            }
+
+            addSegment(m_map, start, end, address);
+            addSegment(m_map, end, start, address);
         }
         infile.ignore(10000, '\n');
     }
     return true;
 }
 
+bool StreetMapImpl::loadTiled(ifstream& infile)
+{
+    int tileCount;
+    if (!(infile >> m_tileDegrees >> m_maxResidentTiles >> tileCount) || m_tileDegrees <= 0)
+    {
+        cerr << "Error: Bad tiled map header!" << endl;
+        return false;
+    }
+    if (m_maxResidentTiles < 1)
+        m_maxResidentTiles = 1;
+
+    for (int i = 0; i < tileCount; i++)
+    {
+        long long latIndex;
+        long long lonIndex;
+        Tile t;
+        if (!(infile >> latIndex >> lonIndex >> t.offset >> t.length))
+        {
+            cerr << "Error: Bad tiled map index!" << endl;
+            return false;
+        }
+        t.segments = nullptr;
+        m_tiles.associate(tileKey(latIndex, lonIndex), t);
+    }
+    infile.ignore(10000, '\n');
+
+    // Keep the file open so tiles can be read as the router reaches them.
+    m_tileDataStart = infile.tellg();
+    m_tileFile.swap(infile);
+    m_tiled = true;
+    return true;
+}
+
+  // Return the segments of the tile with this key, reading it from disk if it
+  // isn't resident. The caller must hold m_tileMutex.
+const StreetMapImpl::SegmentMap* StreetMapImpl::residentTile(long long key) const
+{
+    Tile* t = m_tiles.find(key);
+    if (t == nullptr)
+        return nullptr; // no streets in this tile
+
+    if (t->segments != nullptr)
+    {
+        m_residentTiles.splice(m_residentTiles.begin(), m_residentTiles, t->lruPos);
+        return t->segments;
+    }
+
+    string data(t->length, '\0');
+    m_tileFile.clear();
+    m_tileFile.seekg(m_tileDataStart + t->offset);
+    if (!m_tileFile.read(&data[0], t->length))
+    {
+        cerr << "Error: Cannot read map tile!" << endl;
+        return nullptr;
+    }
+
+    SegmentMap* segments = new SegmentMap;
+    istringstream iss(data);
+    string startLat;
+    string startLong;
+    string endLat;
+    string endLong;
+    string name;
+    while (iss >> startLat >> startLong >> endLat >> endLong)
+    {
+        iss.ignore(1);
+        getline(iss, name);
+        addSegment(*segments, GeoCoord(startLat, startLong), GeoCoord(endLat, endLong), name);
+    }
+
+    // Make room by dropping the least recently used tile.
+    if (m_residentTiles.size() >= m_maxResidentTiles)
+    {
+        Tile* victim = m_tiles.find(m_residentTiles.back());
+        delete victim->segments;
+        victim->segments = nullptr;
+        m_residentTiles.pop_back();
+    }
+
+    m_residentTiles.push_front(key);
+    t->lruPos = m_residentTiles.begin();
+    t->segments = segments;
+    return segments;
+}
+
 bool StreetMapImpl::getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSegment>& segs) const
 {
+    if (m_tiled)
+    {
+        lock_guard<mutex> lock(m_tileMutex);
+        const SegmentMap* tile = residentTile(tileKey(gc.latitude, gc.longitude, m_tileDegrees));
+        if (tile == nullptr) return false;
+        const vector<StreetSegment>* val = tile->find(gc);
+        if (val == nullptr) return false;
+        segs = *val;
+        return true;
+    }
+
     const vector<StreetSegment>* val = m_map.find(gc);
     if (val == nullptr) return false;
     else
@@ -105,6 +256,70 @@ bool StreetMapImpl::getSegmentsThatStartWith(const GeoCoord& gc, vector<StreetSe
     }
 }
 
+//******************** Tiled map conversion ***********************************
+
+bool writeTiledMap(string mapFile, string tiledFile, double tileDegrees, int maxResidentTiles)
+{
+    ifstream infile(mapFile);
+    if ( ! infile )
+    {
+        cerr << "Error: Cannot open " << mapFile << "!" << endl;
+        return false;
+    }
+    if (tileDegrees <= 0)
+    {
+        cerr << "Error: Tile size must be positive!" << endl;
+        return false;
+    }
+
+    // Group each directed segment under the tile holding its start coordinate,
+    // since that's the tile getSegmentsThatStartWith() will look in.
+    map<pair<long long, long long>, string> tiles;
+    string address;
+    int count;
+    string coords[4];
+    while (getline(infile, address))
+    {
+        if (!(infile >> count))
+            break;
+        infile.ignore(10000, '\n');
+        for (int i = 0; i < count; i++)
+        {
+            infile >> coords[0] >> coords[1] >> coords[2] >> coords[3];
+            for (int dir = 0; dir < 2; dir++)
+            {
+                const string& lat = coords[2 * dir];
+                const string& lon = coords[2 * dir + 1];
+                const string& otherLat = coords[2 - 2 * dir];
+                const string& otherLon = coords[3 - 2 * dir];
+                pair<long long, long long> key(static_cast<long long>(floor(stod(lat) / tileDegrees)),
+                                               static_cast<long long>(floor(stod(lon) / tileDegrees)));
+                tiles[key] += lat + " " + lon + " " + otherLat + " " + otherLon + " " + address + "\n";
+            }
+        }
+        infile.ignore(10000, '\n');
+    }
+
+    ofstream outfile(tiledFile);
+    if ( ! outfile )
+    {
+        cerr << "Error: Cannot create " << tiledFile << "!" << endl;
+        return false;
+    }
+    outfile.precision(17);
+    outfile << TILED_MAP_MAGIC << "\n";
+    outfile << tileDegrees << " " << maxResidentTiles << " " << tiles.size() << "\n";
+    long long offset = 0;
+    for (map<pair<long long, long long>, string>::const_iterator it = tiles.begin(); it != tiles.end(); it++)
+    {
+        outfile << it->first.first << " " << it->first.second << " " << offset << " " << it->second.size() << "\n";
+        offset += it->second.size();
+    }
+    for (map<pair<long long, long long>, string>::const_iterator it = tiles.begin(); it != tiles.end(); it++)
+        outfile << it->second;
+    return static_cast<bool>(outfile);
+}
+
 //******************** StreetMap functions ************************************
 
 // These functions simply delegate to StreetMapImpl's functions.
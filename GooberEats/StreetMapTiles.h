@@ -0,0 +1,38 @@
+#ifndef STREETMAPTILES_INCLUDED
+#define STREETMAPTILES_INCLUDED
+
+#include <string>
+
+// Tiled on-disk map format.
+//
+// A tiled map file holds the same street segments as a mapdata.txt file, but
+// grouped into square lat/lon tiles so StreetMap can read only the tiles the
+// router actually touches. StreetMap::load() recognizes a tiled file by its
+// first line and switches to lazy loading: a tile is read from disk the first
+// time getSegmentsThatStartWith() asks for a coordinate inside it, and the
+// least recently used tile is dropped once more than maxResidentTiles are held.
+//
+// File layout (all text):
+//   GOOBERTILES 1
+//   <tileDegrees> <maxResidentTiles> <tileCount>
+//   <latIndex> <lonIndex> <byteOffset> <byteLength>      (tileCount lines)
+//   <tile data>
+// Each tile's data is one line per directed segment starting in that tile,
+// "startLat startLon endLat endLon street name", and byteOffset is relative
+// to the first byte after the index.
+
+const char* const TILED_MAP_MAGIC = "GOOBERTILES 1";
+
+  // Default tile edge, roughly 0.7 miles of latitude.
+const double DEFAULT_TILE_DEGREES = 0.01;
+
+  // Default cap on tiles held in memory at once by a lazily loaded StreetMap.
+const int DEFAULT_MAX_RESIDENT_TILES = 256;
+
+  // Convert the mapdata.txt-format file mapFile into a tiled map file. The
+  // resident tile cap is recorded in the file and used by StreetMap::load().
+bool writeTiledMap(std::string mapFile, std::string tiledFile,
+                   double tileDegrees = DEFAULT_TILE_DEGREES,
+                   int maxResidentTiles = DEFAULT_MAX_RESIDENT_TILES);
+
+#endif // STREETMAPTILES_INCLUDED
@@ -0,0 +1,269 @@
+#include "SyntheticMap.h"
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+using namespace std;
+
+const char* const AVENUE_NAMES[] = {
+    "Maple", "Oak", "Cedar", "Pine", "Elm", "Willow", "Sycamore", "Magnolia",
+    "Palm", "Laurel", "Hilgard", "Gayley", "Veteran", "Kelton", "Glenrock", "Landfair",
+    "Strathmore", "Levering", "Midvale", "Malcolm", "Selby", "Manning", "Beverly", "Overland",
+    "Sepulveda", "Barrington", "Bundy", "Centinela", "Federal", "Butler", "Colby", "Granville",
+    "Armacost", "Stoner", "Corinth", "Purdue", "Sawtelle", "Westgate", "Brockton", "Wellesley"
+};
+const char* const AVENUE_KINDS[] = { "Avenue", "Boulevard", "Drive", "Way", "Place", "Lane" };
+const char* const ITEMS[] = {
+    "Chicken tenders", "Pad thai", "Burrito", "Pepperoni pizza", "Ramen", "Falafel wrap",
+    "Poke bowl", "Cheeseburger", "Salmon plate", "Boba tea", "Caesar salad", "Dumplings"
+};
+
+const double LONGITUDE_STRETCH = 1.2;   // blocks run a little longer east-west
+const double JITTER = 0.2;              // of a block, each way
+const double BOW = 0.15;                // how far a block curves, in blocks
+const double PI = 4 * atan(1.0);
+
+  // A well-mixed 64-bit hash (splitmix64's finalizer), so a vertex's jitter
+  // and a block's shape come from its position without being stored.
+static unsigned long long mix(unsigned long long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+  // Uniform in [0, 1).
+static double unitHash(unsigned long long seed, long long a, int salt)
+{
+    return (mix(seed ^ mix(static_cast<unsigned long long>(a) * 8 + salt)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static string ordinal(long long n)
+{
+    const char* suffix = "th";
+    if (n % 100 < 11 || n % 100 > 13)
+    {
+        if (n % 10 == 1) suffix = "st";
+        else if (n % 10 == 2) suffix = "nd";
+        else if (n % 10 == 3) suffix = "rd";
+    }
+    return to_string(n) + suffix;
+}
+
+class SyntheticCity
+{
+public:
+    SyntheticCity(const SyntheticMapOptions& options);
+    bool write(const string& mapFile, const string& deliveriesFile, SyntheticMapStats& stats) const;
+private:
+    const SyntheticMapOptions& m_options;
+    long long m_rows;
+    long long m_cols;
+    vector<char> m_keepEast;    // the block east of intersection id
+    vector<char> m_keepNorth;   // the block north of it
+
+    long long id(long long r, long long c) const { return r * m_cols + c; }
+    double latitude(long long r, long long c) const;
+    double longitude(long long r, long long c) const;
+    void appendBlock(string& lines, long long& count, long long from, long long to, bool east, long long& shapePoints) const;
+};
+
+SyntheticCity::SyntheticCity(const SyntheticMapOptions& options)
+ : m_options(options)
+{
+      // A kept block per intersection from the tree, extraStreetChance more
+      // from the rest of the grid, and shapePoints vertices along each.
+    double perIntersection = 1 + (1 + options.extraStreetChance) * options.shapePoints;
+    long long intersections = max(4LL, static_cast<long long>(options.nodes / perIntersection));
+    m_rows = max(2LL, static_cast<long long>(sqrt(static_cast<double>(intersections))));
+    m_cols = max(2LL, (intersections + m_rows - 1) / m_rows);
+    long long n = m_rows * m_cols;
+    m_keepEast.assign(n, 0);
+    m_keepNorth.assign(n, 0);
+
+      // Every block, as id * 2 (+1 for north), in random order.
+    vector<long long> blocks;
+    blocks.reserve(2 * n);
+    for (long long r = 0; r < m_rows; r++)
+    {
+        for (long long c = 0; c < m_cols; c++)
+        {
+            if (c + 1 < m_cols)
+                blocks.push_back(id(r, c) * 2);
+            if (r + 1 < m_rows)
+                blocks.push_back(id(r, c) * 2 + 1);
+        }
+    }
+    mt19937_64 rng(options.seed);
+    shuffle(blocks.begin(), blocks.end(), rng);
+
+      // Kruskal's algorithm: a block joining two parts not yet joined is in
+      // the spanning tree.
+    vector<long long> parent(n);
+    for (long long i = 0; i < n; i++)
+        parent[i] = i;
+    auto find = [&parent](long long x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    uniform_real_distribution<double> chance(0, 1);
+    for (long long k = 0; k < blocks.size(); k++)
+    {
+        long long from = blocks[k] / 2;
+        bool east = (blocks[k] % 2 == 0);
+        long long to = from + (east ? 1 : m_cols);
+        long long a = find(from);
+        long long b = find(to);
+        bool keep;
+        if (a != b)
+        {
+            parent[a] = b;
+            keep = true;
+        }
+        else
+            keep = (chance(rng) < options.extraStreetChance);
+        (east ? m_keepEast : m_keepNorth)[from] = keep;
+    }
+}
+
+double SyntheticCity::latitude(long long r, long long c) const
+{
+    double jitter = (2 * unitHash(m_options.seed, id(r, c), 0) - 1) * JITTER;
+    return m_options.originLatitude + (r + jitter) * m_options.blockDegrees;
+}
+
+double SyntheticCity::longitude(long long r, long long c) const
+{
+    double jitter = (2 * unitHash(m_options.seed, id(r, c), 1) - 1) * JITTER;
+    return m_options.originLongitude + (c + jitter) * LONGITUDE_STRETCH * m_options.blockDegrees;
+}
+
+static void appendSegment(string& lines, double lat1, double lon1, double lat2, double lon2)
+{
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%.7f %.7f %.7f %.7f\n", lat1, lon1, lat2, lon2);
+    lines += buf;
+}
+
+  // The block from intersection `from` east or north to `to`, bowed gently
+  // to one side through its shape points, if it has any.
+void SyntheticCity::appendBlock(string& lines, long long& count, long long from, long long to, bool east, long long& shapePoints) const
+{
+    long long r1 = from / m_cols;
+    long long c1 = from % m_cols;
+    long long r2 = to / m_cols;
+    long long c2 = to % m_cols;
+    double lat1 = latitude(r1, c1);
+    double lon1 = longitude(r1, c1);
+    double lat2 = latitude(r2, c2);
+    double lon2 = longitude(r2, c2);
+    int salt = (east ? 2 : 3);
+    int points = static_cast<int>(unitHash(m_options.seed, from, salt) * (2 * m_options.shapePoints + 1));
+    double bow = (2 * unitHash(m_options.seed, from, salt + 2) - 1) * BOW * m_options.blockDegrees;
+
+    double prevLat = lat1;
+    double prevLon = lon1;
+    for (int i = 1; i <= points; i++)
+    {
+        double t = static_cast<double>(i) / (points + 1);
+        double side = bow * sin(PI * t);
+        double lat = lat1 + (lat2 - lat1) * t + (east ? side : 0);
+        double lon = lon1 + (lon2 - lon1) * t + (east ? 0 : side * LONGITUDE_STRETCH);
+        appendSegment(lines, prevLat, prevLon, lat, lon);
+        prevLat = lat;
+        prevLon = lon;
+    }
+    appendSegment(lines, prevLat, prevLon, lat2, lon2);
+    count += points + 1;
+    shapePoints += points;
+}
+
+bool SyntheticCity::write(const string& mapFile, const string& deliveriesFile, SyntheticMapStats& stats) const
+{
+    ofstream map(mapFile);
+    if (!map)
+        return false;
+
+    long long shapePoints = 0;
+    long long segments = 0;
+    string lines;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool east = (pass == 0);
+        long long streets = (east ? m_rows : m_cols);
+        for (long long s = 0; s < streets; s++)
+        {
+              // A street's blocks go out together under its name.
+            string name;
+            if (east)
+                name = ordinal(s + 1) + " Street";
+            else
+            {
+                const int names = sizeof(AVENUE_NAMES) / sizeof(AVENUE_NAMES[0]);
+                const int kinds = sizeof(AVENUE_KINDS) / sizeof(AVENUE_KINDS[0]);
+                name = string(AVENUE_NAMES[s % names]) + " " + AVENUE_KINDS[(s / names) % kinds];
+            }
+            lines.clear();
+            long long count = 0;
+            long long length = (east ? m_cols : m_rows);
+            for (long long k = 0; k + 1 < length; k++)
+            {
+                long long from = (east ? id(s, k) : id(k, s));
+                if ((east ? m_keepEast : m_keepNorth)[from])
+                    appendBlock(lines, count, from, from + (east ? 1 : m_cols), east, shapePoints);
+            }
+            if (count > 0)
+                map << name << '\n' << count << '\n' << lines;
+            segments += count;
+        }
+    }
+    if (!map)
+        return false;
+
+    stats.vertices = m_rows * m_cols + shapePoints;
+    stats.segments = segments;
+    stats.degreeCounts.assign(5, 0);
+    stats.degreeCounts[2] = shapePoints;
+    for (long long r = 0; r < m_rows; r++)
+    {
+        for (long long c = 0; c < m_cols; c++)
+        {
+            int degree = m_keepEast[id(r, c)] + m_keepNorth[id(r, c)] +
+                         (c > 0 ? m_keepEast[id(r, c - 1)] : 0) + (r > 0 ? m_keepNorth[id(r - 1, c)] : 0);
+            stats.degreeCounts[degree]++;
+        }
+    }
+
+    ofstream deliveries(deliveriesFile);
+    if (!deliveries)
+        return false;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.7f %.7f\n", latitude(m_rows / 2, m_cols / 2), longitude(m_rows / 2, m_cols / 2));
+    deliveries << buf;
+    mt19937_64 rng(mix(m_options.seed));
+    uniform_int_distribution<long long> pickRow(0, m_rows - 1);
+    uniform_int_distribution<long long> pickCol(0, m_cols - 1);
+    const int items = sizeof(ITEMS) / sizeof(ITEMS[0]);
+    for (int k = 0; k < m_options.stops; k++)
+    {
+        long long r = pickRow(rng);
+        long long c = pickCol(rng);
+        snprintf(buf, sizeof(buf), "%.7f %.7f:", latitude(r, c), longitude(r, c));
+        deliveries << buf << ITEMS[k % items] << " (order " << k + 1 << ")\n";
+    }
+    return static_cast<bool>(deliveries);
+}
+
+bool writeSyntheticMap(const string& mapFile, const string& deliveriesFile,
+                       const SyntheticMapOptions& options, SyntheticMapStats& stats)
+{
+    SyntheticCity city(options);
+    return city.write(mapFile, deliveriesFile, stats);
+}
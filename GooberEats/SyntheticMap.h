@@ -0,0 +1,51 @@
+#ifndef SYNTHETICMAP_INCLUDED
+#define SYNTHETICMAP_INCLUDED
+
+#include <string>
+#include <vector>
+
+// Made-up street networks in the mapdata.txt format, of any size, with a
+// deliveries file to go with each, for load-testing the loader, router and
+// planner beyond what the bundled Westwood map can show.
+//
+// The city is a grid of blocks, jittered so that no two streets meet at quite
+// the same angle. A random spanning tree of the grid's edges is kept, so every
+// intersection can reach every other; each remaining edge is kept with
+// probability extraStreetChance, which leaves the mix of dead ends, T
+// junctions and crossroads that real street networks have. Blocks curve
+// through shape points, the degree-2 vertices real maps are full of. East-west
+// streets are numbered ("12th Street"); north-south ones get names
+// ("Maple Avenue"), which repeat across very wide maps as real ones do.
+
+struct SyntheticMapOptions
+{
+    SyntheticMapOptions()
+     : nodes(50000), stops(100), seed(1), extraStreetChance(0.3), shapePoints(3),
+       originLatitude(34.0), originLongitude(-118.5), blockDegrees(0.001)
+    {}
+
+    long long nodes;            // roughly how many vertices the map should have
+    int stops;                  // deliveries to write
+    unsigned long long seed;    // same seed, same map and deliveries
+    double extraStreetChance;
+    double shapePoints;         // mean vertices partway along a block
+    double originLatitude;      // the grid's south-west corner
+    double originLongitude;
+    double blockDegrees;        // north-south block length
+};
+
+struct SyntheticMapStats
+{
+    long long vertices;
+    long long segments;
+    std::vector<long long> degreeCounts;   // degreeCounts[d] vertices have d segments
+};
+
+  // Write a map to mapFile and a deliveries file for it to deliveriesFile. The
+  // depot is the intersection nearest the middle; stops are intersections
+  // picked at random, so all are on the map and reachable. Returns false if
+  // either file can't be written.
+bool writeSyntheticMap(const std::string& mapFile, const std::string& deliveriesFile,
+                       const SyntheticMapOptions& options, SyntheticMapStats& stats);
+
+#endif // SYNTHETICMAP_INCLUDED
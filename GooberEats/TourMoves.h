@@ -0,0 +1,65 @@
+#ifndef TOURMOVES_INCLUDED
+#define TOURMOVES_INCLUDED
+
+#include "DistanceMatrix.h"
+#include <vector>
+#include <algorithm>
+
+// Moves on a tour stored as a permutation of stops 1..n (see DistanceMatrix.h).
+// Each move is scored in constant time from the handful of edges it changes,
+// so a search can reject it without touching the tour.
+
+  // Node at position pos of the tour; positions -1 and n are the depot.
+inline int nodeAt(const std::vector<int>& tour, int pos)
+{
+    return (pos < 0 || pos >= static_cast<int>(tour.size())) ? 0 : tour[pos];
+}
+
+  // Change in length from exchanging the stops at positions i < j.
+inline double swapDelta(const DistanceMatrix& d, const std::vector<int>& tour, int i, int j)
+{
+    int a = tour[i];
+    int b = tour[j];
+    int beforeA = nodeAt(tour, i - 1);
+    int afterB = nodeAt(tour, j + 1);
+    if (j == i + 1)
+        return d(beforeA, b) + d(b, a) + d(a, afterB) - d(beforeA, a) - d(a, b) - d(b, afterB);
+
+    int afterA = nodeAt(tour, i + 1);
+    int beforeB = nodeAt(tour, j - 1);
+    return d(beforeA, b) + d(b, afterA) + d(beforeB, a) + d(a, afterB)
+         - d(beforeA, a) - d(a, afterA) - d(beforeB, b) - d(b, afterB);
+}
+
+  // Change in length from reversing positions i..j (2-opt). Only valid for a
+  // symmetric matrix, where the reversed stretch keeps its own length.
+inline double reverseDelta(const DistanceMatrix& d, const std::vector<int>& tour, int i, int j)
+{
+    int before = nodeAt(tour, i - 1);
+    int after = nodeAt(tour, j + 1);
+    return d(before, tour[j]) + d(tour[i], after) - d(before, tour[i]) - d(tour[j], after);
+}
+
+  // Change in length from moving positions i..i+len-1 so they follow position
+  // k (Or-opt). k is -1 for the front of the tour and lies outside i-1..i+len-1.
+inline double relocateDelta(const DistanceMatrix& d, const std::vector<int>& tour, int i, int len, int k)
+{
+    int first = tour[i];
+    int last = tour[i + len - 1];
+    int before = nodeAt(tour, i - 1);
+    int after = nodeAt(tour, i + len);
+    int a = nodeAt(tour, k);
+    int b = nodeAt(tour, k + 1);
+    return d(before, after) - d(before, first) - d(last, after)
+         + d(a, first) + d(last, b) - d(a, b);
+}
+
+inline void relocate(std::vector<int>& tour, int i, int len, int k)
+{
+    if (k > i)
+        std::rotate(tour.begin() + i, tour.begin() + i + len, tour.begin() + k + 1);
+    else
+        std::rotate(tour.begin() + k + 1, tour.begin() + i, tour.begin() + i + len);
+}
+
+#endif // TOURMOVES_INCLUDED
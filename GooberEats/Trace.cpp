@@ -0,0 +1,175 @@
+#include "Trace.h"
+#include "Json.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+using namespace std;
+
+  // Finished events are kept up to this many bytes of JSON. Past that the
+  // oldest are dropped, so a server traced for days keeps its latest hours
+  // rather than growing without bound.
+const size_t MAX_TRACE_BYTES = 256 * 1024 * 1024;
+
+namespace
+{
+    atomic<bool> g_tracing(false);
+    atomic<int> g_nextThread(1);
+    mutex g_mutex;                          // guards everything below
+    chrono::steady_clock::time_point g_epoch;
+    int g_pid;
+    deque<string> g_events;                 // finished events, oldest first
+    size_t g_eventBytes;
+    long long g_dropped;                    // events dropped to stay under the cap
+    vector<pair<int, string> > g_threadNames;
+
+    thread_local int t_threadId = 0;        // 0 until the thread first traces
+
+    int threadId()
+    {
+        if (t_threadId == 0)
+            t_threadId = g_nextThread++;
+        return t_threadId;
+    }
+
+      // Microseconds since startTrace().
+    double now()
+    {
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - g_epoch).count();
+    }
+}
+
+void startTrace()
+{
+    lock_guard<mutex> lock(g_mutex);
+    g_events.clear();
+    g_eventBytes = 0;
+    g_dropped = 0;
+    g_epoch = chrono::steady_clock::now();
+    g_pid = getpid();
+    g_tracing = true;
+}
+
+bool tracing()
+{
+    return g_tracing;
+}
+
+void nameTraceThread(const string& name)
+{
+    lock_guard<mutex> lock(g_mutex);
+    int id = threadId();
+    for (int i = 0; i < g_threadNames.size(); i++)
+    {
+        if (g_threadNames[i].first == id)
+        {
+            g_threadNames[i].second = name;
+            return;
+        }
+    }
+    g_threadNames.push_back(make_pair(id, name));
+}
+
+bool stopTrace(const string& file)
+{
+    string text;
+    {
+        lock_guard<mutex> lock(g_mutex);
+        g_tracing = false;
+        string pid = to_string(g_pid);
+        text = "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" + to_string(g_dropped);
+        text.reserve(g_eventBytes + 4096);
+        text += "},\"traceEvents\":[\n";
+        for (int i = 0; i < g_threadNames.size(); i++)
+        {
+            text += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid;
+            text += ",\"tid\":" + to_string(g_threadNames[i].first) + ",\"args\":{\"name\":";
+            appendJsonString(text, g_threadNames[i].second);
+            text += "}},\n";
+        }
+        for (size_t i = 0; i < g_events.size(); i++)
+            text += g_events[i];
+        if (!g_events.empty() || !g_threadNames.empty())
+            text.resize(text.size() - 2); // the last event's ",\n"
+        text += "\n]}\n";
+        g_events.clear();
+        g_eventBytes = 0;
+    }
+    ofstream out(file);
+    out << text;
+    return static_cast<bool>(out);
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+ : m_name(name), m_category(category), m_start(-1)
+{
+    if (g_tracing)
+        m_start = now();
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (m_start < 0 || !g_tracing)
+        return;
+    double duration = now() - m_start;
+
+    string event = "{\"name\":";
+    appendJsonString(event, m_name);
+    event += ",\"cat\":";
+    appendJsonString(event, m_category);
+    event += ",\"ph\":\"X\",\"ts\":";
+    appendJsonNumber(event, m_start, 3);
+    event += ",\"dur\":";
+    appendJsonNumber(event, duration, 3);
+    event += ",\"pid\":" + to_string(g_pid);
+    event += ",\"tid\":" + to_string(threadId());
+    if (!m_args.empty())
+        event += ",\"args\":{" + m_args + "}";
+    event += "},\n";
+
+    lock_guard<mutex> lock(g_mutex);
+    g_eventBytes += event.size();
+    g_events.push_back(string());
+    g_events.back().swap(event);
+    while (g_eventBytes > MAX_TRACE_BYTES && g_events.size() > 1)
+    {
+        g_eventBytes -= g_events.front().size();
+        g_events.pop_front();
+        g_dropped++;
+    }
+}
+
+void TraceSpan::startArg(const char* key)
+{
+    if (!m_args.empty())
+        m_args += ',';
+    appendJsonString(m_args, key);
+    m_args += ':';
+}
+
+void TraceSpan::arg(const char* key, long long value)
+{
+    if (m_start < 0)
+        return;
+    startArg(key);
+    m_args += to_string(value);
+}
+
+void TraceSpan::arg(const char* key, double value)
+{
+    if (m_start < 0)
+        return;
+    startArg(key);
+    appendJsonNumber(m_args, value, 4);
+}
+
+void TraceSpan::arg(const char* key, const string& value)
+{
+    if (m_start < 0)
+        return;
+    startArg(key);
+    appendJsonString(m_args, value);
+}
@@ -0,0 +1,57 @@
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <string>
+
+// Timelines of where a run spends its time, in Chrome's trace event format, to
+// open in chrome://tracing or ui.perfetto.dev. Code marks what it's doing with
+// a TraceSpan on the stack; each span becomes one bar on its thread's row,
+// nested under the spans open around it.
+//
+// Tracing is off until startTrace() is called. While it's off a TraceSpan
+// reads one flag and does nothing else, so spans can stay in code that runs
+// thousands of times a second. A long trace keeps only its most recent spans,
+// dropping the oldest once they'd take more than MAX_TRACE_BYTES (in
+// Trace.cpp) to write; the file says how many were dropped.
+
+  // Start recording spans, dropping any recorded before. Times are from now.
+void startTrace();
+
+  // Stop recording and write what was recorded to file. Returns false if it
+  // can't be written.
+bool stopTrace(const std::string& file);
+
+bool tracing();
+
+  // Names the calling thread's row in the trace ("main", "pool 2", ...).
+  // Threads that aren't named show up by number.
+void nameTraceThread(const std::string& name);
+
+class TraceSpan
+{
+public:
+      // name and category aren't copied, so they must outlive the span;
+      // string literals are the usual thing.
+    TraceSpan(const char* name, const char* category = "planner");
+    ~TraceSpan();
+
+      // Values shown with the span when it's selected.
+    void arg(const char* key, int value) { arg(key, static_cast<long long>(value)); }
+    void arg(const char* key, long long value);
+    void arg(const char* key, double value);
+    void arg(const char* key, const std::string& value);
+
+      // We prevent a TraceSpan object from being copied or assigned.
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    double m_start;             // microseconds into the trace, or -1 if off
+    std::string m_args;         // "key":value pairs, comma separated
+
+    void startArg(const char* key);
+};
+
+#endif // TRACE_INCLUDED
@@ -0,0 +1,90 @@
+#include "WarmStart.h"
+#include "ExpandableHashMap.h"
+#include "DeliveryFile.h"
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+vector<int> warmStartTour(const DistanceMatrix& d, const vector<DeliveryRequest>& deliveries,
+                          const vector<GeoCoord>& hint)
+{
+    int n = static_cast<int>(deliveries.size());
+
+      // Nodes at each location, last first, so entries claim them in order.
+    ExpandableHashMap<GeoCoord, vector<int> > atLocation;
+    for (int i = n; i >= 1; i--)
+    {
+        vector<int>* nodes = atLocation.find(deliveries[i - 1].location);
+        if (nodes != nullptr)
+            nodes->push_back(i);
+        else
+            atLocation.associate(deliveries[i - 1].location, vector<int>(1, i));
+    }
+
+    vector<int> tour;
+    tour.reserve(n);
+    vector<char> placed(n + 1, 0);
+    for (int k = 0; k < hint.size(); k++)
+    {
+        vector<int>* nodes = atLocation.find(hint[k]);
+        if (nodes == nullptr || nodes->empty())
+            continue;
+        tour.push_back(nodes->back());
+        placed[nodes->back()] = 1;
+        nodes->pop_back();
+    }
+
+    for (int s = 1; s <= n; s++)
+    {
+        if (placed[s])
+            continue;
+          // Inserting before position p (p == size() meaning before the
+          // return to the depot) replaces prev -> next with prev -> s -> next.
+        int m = static_cast<int>(tour.size());
+        int best = 0;
+        double bestCost = 0;
+        for (int p = 0; p <= m; p++)
+        {
+            int prev = (p == 0 ? 0 : tour[p - 1]);
+            int next = (p == m ? 0 : tour[p]);
+            double cost = d(prev, s) + d(s, next) - d(prev, next);
+            if (p == 0 || cost < bestCost)
+            {
+                bestCost = cost;
+                best = p;
+            }
+        }
+        tour.insert(tour.begin() + best, s);
+    }
+    return tour;
+}
+
+bool loadOrderHint(string hintFile, vector<GeoCoord>& hint)
+{
+    ifstream inf(hintFile);
+    if (!inf)
+        return false;
+
+    hint.clear();
+    string line;
+    while (getline(inf, line))
+    {
+        istringstream iss(line);
+        string lat;
+        string lon;
+        if (iss >> lat >> lon && isCoordinate(lat) && isCoordinate(lon))
+            hint.push_back(GeoCoord(lat, lon));
+    }
+    return true;
+}
+
+bool saveOrderHint(string hintFile, const vector<DeliveryRequest>& deliveries)
+{
+    ofstream outf(hintFile);
+    if (!outf)
+        return false;
+
+    for (int i = 0; i < deliveries.size(); i++)
+        outf << deliveries[i].location.latitudeText << " " << deliveries[i].location.longitudeText << endl;
+    return static_cast<bool>(outf);
+}
@@ -0,0 +1,26 @@
+#ifndef WARMSTART_INCLUDED
+#define WARMSTART_INCLUDED
+
+#include "provided.h"
+#include "DistanceMatrix.h"
+#include <string>
+#include <vector>
+
+// Starting the optimizer from a previous day's order. A hint is just delivery
+// locations in the order they were visited, so it survives the items (and the
+// delivery list's order) changing from one day to the next.
+
+  // A tour (numbered as in d, whose node i is deliveries[i-1]) that visits
+  // the deliveries found in hint in hint's order. Each hint entry claims at
+  // most one delivery at its location; deliveries no entry claimed are then
+  // inserted one at a time wherever they lengthen the tour least.
+std::vector<int> warmStartTour(const DistanceMatrix& d, const std::vector<DeliveryRequest>& deliveries,
+                               const std::vector<GeoCoord>& hint);
+
+  // The hint file format: one "latitude longitude" line per stop. A line
+  // without two plain decimals (see isCoordinate() in DeliveryFile.h) is
+  // skipped.
+bool loadOrderHint(std::string hintFile, std::vector<GeoCoord>& hint);
+bool saveOrderHint(std::string hintFile, const std::vector<DeliveryRequest>& deliveries);
+
+#endif // WARMSTART_INCLUDED
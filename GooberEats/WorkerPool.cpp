@@ -0,0 +1,66 @@
+#include "WorkerPool.h"
+#include "Trace.h"
+using namespace std;
+
+WorkerPool::WorkerPool(int threads)
+ : m_task(nullptr), m_count(0), m_next(0), m_unfinished(0), m_stopping(false)
+{
+    for (int k = 1; k < threads; k++)
+        m_workers.push_back(thread(&WorkerPool::workerLoop, this, k));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (int k = 0; k < m_workers.size(); k++)
+        m_workers[k].join();
+}
+
+  // Take tasks until none are left to start. Called with lock held; the lock
+  // is released while each task runs.
+void WorkerPool::runTasks(unique_lock<mutex>& lock)
+{
+    while (hasWork())
+    {
+        int i = m_next++;
+        const function<void(int)>& task = *m_task;
+        lock.unlock();
+        task(i);
+        lock.lock();
+        if (--m_unfinished == 0)
+            m_done.notify_all();
+    }
+}
+
+void WorkerPool::workerLoop(int k)
+{
+    nameTraceThread("pool thread " + to_string(k));
+    unique_lock<mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stopping || hasWork(); });
+        if (m_stopping)
+            return;
+        runTasks(lock);
+    }
+}
+
+void WorkerPool::run(int count, const function<void(int)>& task)
+{
+    if (count <= 0)
+        return;
+    lock_guard<mutex> turn(m_runMutex);
+    unique_lock<mutex> lock(m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_next = 0;
+    m_unfinished = count;
+    m_wake.notify_all();
+    runTasks(lock);
+    m_done.wait(lock, [this]() { return m_unfinished == 0; });
+    m_task = nullptr;
+}
@@ -0,0 +1,50 @@
+#ifndef WORKERPOOL_INCLUDED
+#define WORKERPOOL_INCLUDED
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A fixed set of threads for running batches of independent tasks. The
+// threads live as long as the pool, so a caller that runs many small batches
+// (one per plan, say) doesn't pay to start threads each time.
+
+class WorkerPool
+{
+public:
+      // threads counts the thread that calls run(), which works too, so a
+      // pool of 1 starts no threads and runs everything on the caller.
+    WorkerPool(int threads);
+    ~WorkerPool();
+
+    int size() const { return static_cast<int>(m_workers.size()) + 1; }
+
+      // Call task(0), ..., task(count-1), spread over the pool, and return
+      // once all have finished. Tasks may run in any order. Calls to run()
+      // from different threads take turns.
+    void run(int count, const std::function<void(int)>& task);
+
+      // We prevent a WorkerPool object from being copied or assigned.
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_runMutex;          // held for the whole of run()
+    std::mutex m_mutex;             // guards everything below
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(int)>* m_task;
+    int m_count;
+    int m_next;
+    int m_unfinished;
+    bool m_stopping;
+
+    bool hasWork() const { return m_task != nullptr && m_next < m_count; }
+    void runTasks(std::unique_lock<std::mutex>& lock);
+    void workerLoop(int k);
+};
+
+#endif // WORKERPOOL_INCLUDED
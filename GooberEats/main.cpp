@@ -7,101 +7,234 @@
 using namespace std;
 
 #include "ExpandableHashMap.h"
+#include "StreetMapTiles.h"
+#include "PlannerOptions.h"
+#include "PlanServer.h"
+#include "DeliveryFile.h"
+#include "BatchPlanner.h"
+#include "SyntheticMap.h"
+#include "Trace.h"
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
 
-bool loadDeliveryRequests(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v);
-bool parseDelivery(string line, string& lat, string& lon, string& item);
+  // Write the trace started by --trace, if there is one.
+static void finishTrace(const string& traceFile)
+{
+    if (!traceFile.empty() && !stopTrace(traceFile))
+        cerr << "Unable to write trace file " << traceFile << endl;
+}
 
-//int main(int argc, char *argv[])
-//{
-//    if (argc != 3)
-//    {
-//        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt" << endl;
-//        return 1;
-//    }
-//
-//    StreetMap sm;
-//
-//    if (!sm.load(argv[1]))
-//    {
-//        cout << "Unable to load map data file " << argv[1] << endl;
-//        return 1;
-//    }
-//
-//    GeoCoord depot;
-//    vector<DeliveryRequest> deliveries;
-//    if (!loadDeliveryRequests(argv[2], depot, deliveries))
-//    {
-//        cout << "Unable to load delivery request file " << argv[2] << endl;
-//        return 1;
-//    }
-//
-//    cout << "Generating route...\n\n";
-//
-//    DeliveryPlanner dp(&sm);
-//    vector<DeliveryCommand> dcs;
-//    double totalMiles;
-//    DeliveryResult result = dp.generateDeliveryPlan(depot, deliveries, dcs, totalMiles);
-//    if (result == BAD_COORD)
-//    {
-//        cout << "One or more depot or delivery coordinates are invalid." << endl;
-//        return 1;
-//    }
-//    if (result == NO_ROUTE)
-//    {
-//        cout << "No route can be found to deliver all items." << endl;
-//        return 1;
-//    }
-//    cout << "Starting at the depot...\n";
-//    for (const auto& dc : dcs)
-//        cout << dc.description() << endl;
-//    cout << "You are back at the depot and your deliveries are done!\n";
-//    cout.setf(ios::fixed);
-//    cout.precision(2);
-//    cout << totalMiles << " miles travelled for all deliveries." << endl;
-//}
-//
-//bool loadDeliveryRequests(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v)
-//{
-//    ifstream inf(deliveriesFile);
-//    if (!inf)
-//        return false;
-//    string lat;
-//    string lon;
-//    inf >> lat >> lon;
-//    inf.ignore(10000, '\n');
-//    depot = GeoCoord(lat, lon);
-//    string line;
-//    while (getline(inf, line))
-//    {
-//        string item;
-//        if (parseDelivery(line, lat, lon, item))
-//            v.push_back(DeliveryRequest(item, GeoCoord(lat, lon)));
-//    }
-//    return true;
-//}
-//
-//bool parseDelivery(string line, string& lat, string& lon, string& item)
-//{
-//    const size_t colon = line.find(':');
-//    if (colon == string::npos)
-//    {
-//        cout << "Missing colon in deliveries file line: " << line << endl;
-//        return false;
-//    }
-//    istringstream iss(line.substr(0, colon));
-//    if (!(iss >> lat >> lon))
-//    {
-//        cout << "Bad format in deliveries file line: " << line << endl;
-//        return false;
-//    }
-//    item = line.substr(colon + 1);
-//    if (item.empty())
-//    {
-//        cout << "Missing item in deliveries file line: " << line << endl;
-//        return false;
-//    }
-//    return true;
-//}
+  // A server only stops when it's killed, so write its trace when it's told
+  // to stop. SIGINT and SIGTERM are blocked in every thread (call this before
+  // starting any) and waited for on one more, which writes the trace and
+  // exits as the signal would have.
+static void finishTraceOnSignal(const string& traceFile)
+{
+    if (traceFile.empty())
+        return;
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    thread([traceFile, stopSignals]()
+    {
+        int sig = 0;
+        sigwait(&stopSignals, &sig);
+        finishTrace(traceFile);
+        _exit(128 + sig);
+    }).detach();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 4 && string(argv[1]) == "--tile")
+    {
+          // Convert a mapdata.txt file into the lazily loaded tiled format.
+        double tileDegrees = (argc >= 5 ? stod(argv[4]) : DEFAULT_TILE_DEGREES);
+        int maxResidentTiles = (argc >= 6 ? stoi(argv[5]) : DEFAULT_MAX_RESIDENT_TILES);
+        if (!writeTiledMap(argv[2], argv[3], tileDegrees, maxResidentTiles))
+        {
+            cout << "Unable to write tiled map file " << argv[3] << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc >= 5 && string(argv[1]) == "--generate")
+    {
+          // Make up a map of about this many vertices, and deliveries for it.
+        SyntheticMapOptions generate;
+        generate.nodes = stoll(argv[2]);
+        if (argc >= 6)
+            generate.stops = stoi(argv[5]);
+        if (argc >= 7)
+            generate.seed = stoull(argv[6]);
+        SyntheticMapStats stats;
+        if (!writeSyntheticMap(argv[3], argv[4], generate, stats))
+        {
+            cout << "Unable to write " << argv[3] << " or " << argv[4] << endl;
+            return 1;
+        }
+        cout << stats.vertices << " vertices, " << stats.segments << " segments; by degree:";
+        for (int d = 1; d < stats.degreeCounts.size(); d++)
+            cout << " " << d << ": " << stats.degreeCounts[d];
+        cout << endl;
+        return 0;
+    }
+
+      // --road orders the deliveries by driving distance instead of crow-flies.
+      // --hint starts from the order saved in hint.txt, if there is one, and
+      // saves this run's order there for next time. --threads routes the legs
+      // on that many threads. --serve loads the map and then answers JSON
+      // requests (see PlanServer.h) on stdin, or on a Unix socket given with
+      // --socket; there, --threads is how many requests are worked on at once.
+      // --batch plans every deliveries file in a directory (or listed in a
+      // manifest) into --out, --threads files at a time. --stats prints what
+      // the plan took (see PlanStats.h) to cerr. --trace records a timeline of
+      // the run (see Trace.h) and writes it to the given file at the end; a
+      // server writes it when stopped with SIGINT or SIGTERM.
+    PlannerOptions options;
+    string hintFile;
+    bool serve = false;
+    string socketPath;
+    string batchInput;
+    string batchOut = "plans";
+    int threads = 1;
+    bool printStats = false;
+    string traceFile;
+    int arg = 1;
+    while (arg < argc && string(argv[arg]).compare(0, 2, "--") == 0)
+    {
+        string flag = argv[arg];
+        if (flag == "--road")
+            options.optimizer.metric = ROAD_DISTANCE;
+        else if (flag == "--hint" && arg + 1 < argc)
+            hintFile = argv[++arg];
+        else if (flag == "--threads" && arg + 1 < argc)
+            threads = stoi(argv[++arg]);
+        else if (flag == "--serve")
+            serve = true;
+        else if (flag == "--socket" && arg + 1 < argc)
+        {
+            serve = true;
+            socketPath = argv[++arg];
+        }
+        else if (flag == "--batch" && arg + 1 < argc)
+            batchInput = argv[++arg];
+        else if (flag == "--out" && arg + 1 < argc)
+            batchOut = argv[++arg];
+        else if (flag == "--stats")
+            printStats = true;
+        else if (flag == "--trace" && arg + 1 < argc)
+            traceFile = argv[++arg];
+        else
+            break;
+        arg++;
+    }
+
+    if (argc - arg != (serve || !batchInput.empty() ? 1 : 2))
+    {
+        cout << "Usage: " << argv[0] << " [--road] [--hint hint.txt] [--threads n] [--stats] [--trace trace.json] mapdata.txt deliveries.txt" << endl;
+        cout << "       " << argv[0] << " --serve [--road] [--threads n] [--socket path] [--trace trace.json] mapdata.txt" << endl;
+        cout << "       " << argv[0] << " --batch dir|manifest [--out dir] [--road] [--threads n] [--trace trace.json] mapdata.txt" << endl;
+        cout << "       " << argv[0] << " --tile mapdata.txt tiled.txt [tileDegrees] [maxResidentTiles]" << endl;
+        cout << "       " << argv[0] << " --generate vertices mapdata.txt deliveries.txt [stops] [seed]" << endl;
+        return 1;
+    }
+
+    if (!traceFile.empty())
+    {
+        nameTraceThread("main");
+        startTrace();
+    }
+
+    StreetMap sm;
+
+    if (!sm.load(argv[arg]))
+    {
+        cout << "Unable to load map data file " << argv[arg] << endl;
+        return 1;
+    }
+
+    if (serve)
+    {
+        PlanServer server(&sm, options);
+        finishTraceOnSignal(traceFile);
+        cerr << "Map loaded; serving requests." << endl;
+        bool served = true;
+        if (socketPath.empty())
+            server.serveStream(cin, cout, threads);
+        else
+            served = server.serveUnixSocket(socketPath, threads);
+        finishTrace(traceFile);
+        return (served ? 0 : 1);
+    }
+
+    if (!batchInput.empty())
+    {
+        vector<string> files;
+        if (!findDeliveryFiles(batchInput, files))
+        {
+            cout << "Unable to read " << batchInput << endl;
+            return 1;
+        }
+        vector<BatchResult> results;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        planBatch(&sm, options, threads, files, batchOut, results);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printBatchReport(results, seconds, threads, cout);
+        finishTrace(traceFile);
+        return 0;
+    }
+    options.routingThreads = threads;
+
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+    if (!loadDeliveryRequests(argv[arg + 1], depot, deliveries))
+    {
+        cout << "Unable to load delivery request file " << argv[arg + 1] << endl;
+        return 1;
+    }
+
+    if (!hintFile.empty())
+        loadOrderHint(hintFile, options.optimizer.orderHint); // a missing file just means a cold start
+
+    cout << "Generating route...\n\n";
+
+    ConfigurableDeliveryPlanner dp(&sm, options);
+    DeliveryPlan plan;
+    PlanStats stats;
+    DeliveryResult result = dp.generateDeliveryPlan(depot, deliveries, plan, (printStats ? &stats : nullptr));
+    if (printStats)
+        printPlanStats(stats, cerr);
+    if (result == BAD_COORD)
+    {
+        cout << "One or more depot or delivery coordinates are invalid." << endl;
+        return 1;
+    }
+    if (result == NO_ROUTE)
+    {
+        cout << "No route can be found to deliver all items." << endl;
+        return 1;
+    }
+    if (!hintFile.empty() && !saveOrderHint(hintFile, plan.stops))
+        cerr << "Unable to save order hint file " << hintFile << endl;
+    vector<DeliveryCommand> dcs;
+    plan.appendCommands(dcs);
+    double totalMiles = plan.totalDistance();
+    cout << "Starting at the depot...\n";
+    for (const auto& dc : dcs)
+        cout << dc.description() << endl;
+    cout << "You are back at the depot and your deliveries are done!\n";
+    cout.setf(ios::fixed);
+    cout.precision(2);
+    cout << totalMiles << " miles travelled for all deliveries." << endl;
+    finishTrace(traceFile);
+}
 
 //unsigned int hasher(int key)
 //{
@@ -143,42 +276,42 @@ bool parseDelivery(string line, string& lat, string& lon, string& item);
 //}
 
 
-int main(int argc, char *argv[])
-{
-    if (argc != 3)
-    {
-        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt" << endl;
-        return 1;
-    }
-
-    StreetMap sm;
-
-    if (!sm.load(argv[1]))
-    {
-        cout << "Unable to load map data file " << argv[1] << endl;
-        return 1;
-    }
-
-    cerr << "======" << endl;
-//    vector<StreetSegment> segs;
-//    sm.getSegmentsThatStartWith(GeoCoord("34.0778884", "-118.4514101"), segs);
-//    for (int i = 0; i < segs.size(); i++)
+//int main(int argc, char *argv[])
+//{
+//    if (argc != 3)
 //    {
-//        cerr << segs[i].end.latitudeText << " " << segs[i].end.longitudeText << endl;
+//        cout << "Usage: " << argv[0] << " mapdata.txt deliveries.txt" << endl;
+//        return 1;
 //    }
-
-    PointToPointRouter p(&sm);
-    list<StreetSegment> route;
-    double totalDist = 0;
-    p.generatePointToPointRoute(GeoCoord("34.0695225", "-118.4779716"), GeoCoord("34.0694514", "-118.4786154"), route, totalDist);
-    list<StreetSegment>::iterator it = route.begin();
-    while (it != route.end())
-    {
-        cerr << "start: " << it->start.latitudeText << " " << it->start.longitudeText << " end: " << it->end.latitudeText << " " << it->end.longitudeText << " " << it->name << endl;
-        it++;
-    }
-    cerr << "total distance: " << totalDist << endl;
-}
+//
+//    StreetMap sm;
+//
+//    if (!sm.load(argv[1]))
+//    {
+//        cout << "Unable to load map data file " << argv[1] << endl;
+//        return 1;
+//    }
+//
+//    cerr << "======" << endl;
+////    vector<StreetSegment> segs;
+////    sm.getSegmentsThatStartWith(GeoCoord("34.0778884", "-118.4514101"), segs);
+////    for (int i = 0; i < segs.size(); i++)
+////    {
+////        cerr << segs[i].end.latitudeText << " " << segs[i].end.longitudeText << endl;
+////    }
+//
+//    PointToPointRouter p(&sm);
+//    list<StreetSegment> route;
+//    double totalDist = 0;
+//    p.generatePointToPointRoute(GeoCoord("34.0695225", "-118.4779716"), GeoCoord("34.0694514", "-118.4786154"), route, totalDist);
+//    list<StreetSegment>::iterator it = route.begin();
+//    while (it != route.end())
+//    {
+//        cerr << "start: " << it->start.latitudeText << " " << it->start.longitudeText << " end: " << it->end.latitudeText << " " << it->end.longitudeText << " " << it->name << endl;
+//        it++;
+//    }
+//    cerr << "total distance: " << totalDist << endl;
+//}
 
 //int main()
 //{
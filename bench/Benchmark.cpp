@@ -0,0 +1,825 @@
+#include "provided.h"
+#include "PlannerOptions.h"
+#include "StreetGraph.h"
+#include "LegCompiler.h"
+#include "DeliveryFile.h"
+#include "Json.h"
+#include "PlanStats.h"
+#include "DistanceKernel.h"
+#include "HeldKarp.h"
+#include "PlanEncoding.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// End-to-end timings on a real map, written as JSON with one value per line
+// so that two runs (say, before and after a change) can be compared with diff.
+//
+// Usage: Benchmark [--quick] [--seed n] [--routes n] [--out results.json]
+//                  mapdata.txt [deliveries.txt]
+//
+// Random routes and stops are drawn, with the seed, from the part of the map
+// that can be driven to from the deliveries file's depot, so every route and
+// plan exists. Each section draws from its own generator, so --quick picks the
+// same stops as a full run for the sizes it does. The miles reported alongside
+// each time are checksums: if they change between commits, the results
+// changed, not just the speed. Search counters are taken in a second pass, so
+// the times are for uncounted searches. The exit status is 1 if a check (the
+// distance kernel's accuracy in either mode, the two deliveries file loaders
+// agreeing, or a plan surviving the trip through its binary form) fails.
+
+const int LOAD_REPEATS = 3;
+const int DEFAULT_ROUTES = 200;
+const int OPTIMIZER_SIZES[] = { 10, 25, 50, 100, 200, 400 };
+const int PLAN_SIZES[] = { 25, 100 };
+const int QUICK_MAX_STOPS = 50;
+const int QUICK_ROUTES = 50;
+const int KERNEL_PAIRS = 1 << 20;
+const int QUICK_KERNEL_PAIRS = 1 << 16;
+const int INGEST_LINES = 300000;
+const int QUICK_INGEST_LINES = 30000;
+const int THREAD_SWEEP[] = { 1, 2, 4, 8, 16 };
+const int THREAD_SWEEP_STOPS = 200;
+const int EXACT_SWEEP_MIN_STOPS = 8;
+const int EXACT_SWEEP_MAX_STOPS = 16;
+const int QUICK_EXACT_SWEEP_MAX_STOPS = 12;
+const int STRATEGY_SIZES[] = { 50, 200, 1000 };
+const int CLUSTER_SIZES[] = { 400, 1000, 2000 };
+const int CLUSTER_STOPS = 100;
+const int ENCODING_STOPS = 25;
+const int ENCODING_REPEATS = 100;
+
+  // The batch distance kernel must agree with distanceEarthMiles() at least
+  // this closely (as a fraction of the distance), or the benchmark fails.
+const double KERNEL_TOLERANCE = 1e-12;
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+  // The nearest-rank percentile of sorted values.
+static double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    int rank = static_cast<int>(ceil(p / 100 * sorted.size()));
+    return sorted[max(rank, 1) - 1];
+}
+
+  // Builds the JSON text: a key per line, two-space indents.
+class JsonReport
+{
+public:
+    JsonReport() : m_depth(0), m_first(true) {}
+
+    void open(const string& key, char bracket) { startValue(key); m_text += bracket; m_depth++; m_first = true; }
+    void close(char bracket) { m_depth--; newline(); m_text += bracket; m_first = false; }
+    void number(const string& key, double x, int decimals) { startValue(key); appendJsonNumber(m_text, x, decimals); }
+    void integer(const string& key, long long x) { startValue(key); m_text += to_string(x); }
+    void text(const string& key, const string& s) { startValue(key); appendJsonString(m_text, s); }
+    const string& str() const { return m_text; }
+
+private:
+    string m_text;
+    int m_depth;
+    bool m_first;
+
+    void newline()
+    {
+        m_text += '\n';
+        m_text.append(2 * m_depth, ' ');
+    }
+
+      // An empty key is for an array element.
+    void startValue(const string& key)
+    {
+        if (m_depth > 0)
+        {
+            if (!m_first)
+                m_text += ',';
+            newline();
+        }
+        m_first = false;
+        if (!key.empty())
+        {
+            appendJsonString(m_text, key);
+            m_text += ": ";
+        }
+    }
+};
+
+static vector<DeliveryRequest> randomStops(const vector<GeoCoord>& places, int n, mt19937_64& rng)
+{
+    uniform_int_distribution<size_t> pick(0, places.size() - 1);
+    vector<DeliveryRequest> stops;
+    for (int i = 0; i < n; i++)
+        stops.push_back(DeliveryRequest("item " + to_string(i + 1), places[pick(rng)]));
+    return stops;
+}
+
+  // Times n distances from distanceEarthMiles() and from the batch kernel in
+  // both modes, between a[i] and b[i], and finds each mode's worst relative
+  // error.
+static void benchmarkKernel(JsonReport& report, const string& key, const vector<GeoCoord>& a,
+                            const vector<GeoCoord>& b, double& maxError, double& flatError)
+{
+    size_t n = a.size();
+    vector<double> expected(n);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; i++)
+        expected[i] = distanceEarthMiles(a[i], b[i]);
+    double scalarMs = msSince(start);
+
+    start = Clock::now();
+    GeoPointBuffer from;
+    GeoPointBuffer to;
+    from.reserve(n);
+    to.reserve(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        from.push_back(a[i]);
+        to.push_back(b[i]);
+    }
+    double fillMs = msSince(start);
+    vector<double> actual(n);
+    start = Clock::now();
+    batchDistanceMiles(from, to, actual.data());
+    double batchMs = msSince(start);
+    vector<double> flat(n);
+    start = Clock::now();
+    batchDistanceMiles(from, to, flat.data(), EQUIRECTANGULAR);
+    double flatMs = msSince(start);
+
+    maxError = 0;
+    flatError = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (expected[i] > 0)
+        {
+            maxError = max(maxError, fabs(actual[i] - expected[i]) / expected[i]);
+            flatError = max(flatError, fabs(flat[i] - expected[i]) / expected[i]);
+        }
+        else
+        {
+            maxError = max(maxError, fabs(actual[i]));
+            flatError = max(flatError, fabs(flat[i]));
+        }
+    }
+
+    report.open(key, '{');
+    report.integer("pairs", static_cast<long long>(n));
+    report.number("scalar_ms", scalarMs, 3);
+    report.number("fill_ms", fillMs, 3);
+    report.number("batch_ms", batchMs, 3);
+    report.number("scalar_ns_per_pair", scalarMs * 1e6 / n, 2);
+    report.number("batch_ns_per_pair", batchMs * 1e6 / n, 2);
+    report.number("max_relative_error", maxError, 17);
+    report.number("equirectangular_ms", flatMs, 3);
+    report.number("equirectangular_ns_per_pair", flatMs * 1e6 / n, 2);
+    report.number("equirectangular_max_relative_error", flatError, 17);
+    report.close('}');
+    cout << "distance kernel (" << key << "): " << scalarMs * 1e6 / n << " ns/pair scalar, "
+         << batchMs * 1e6 / n << " ns/pair batch, max relative error " << maxError << "; "
+         << flatMs * 1e6 / n << " ns/pair equirectangular, max relative error " << flatError << endl;
+}
+
+  // The little-endian u32 at data[at], and overwriting it.
+static uint32_t getU32(const string& data, size_t at)
+{
+    uint32_t v = 0;
+    for (int k = 0; k < 4; k++)
+        v |= static_cast<uint32_t>(static_cast<unsigned char>(data[at + k])) << (8 * k);
+    return v;
+}
+
+static void setU32(string& data, size_t at, uint32_t v)
+{
+    for (int k = 0; k < 4; k++)
+        data[at + k] = static_cast<char>((v >> (8 * k)) & 0xFF);
+}
+
+  // Encode a plan, decode it into a fresh NameTable, and check the commands
+  // and their names come back exactly and encode to the same bytes. Then
+  // check that damaged forms of it are refused without touching what they
+  // would have been decoded into: every truncation, a name length that runs
+  // past the end, and a command naming a name that isn't there. Reports the
+  // sizes and times into the object that's open; false if any check fails.
+static bool checkPlanEncoding(JsonReport& report, const vector<PlanCommand>& commands, const NameTable& names)
+{
+    string data;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < ENCODING_REPEATS; r++)
+    {
+        data.clear();
+        encodePlan(commands, names, data);
+    }
+    double encodeMs = msSince(start) / ENCODING_REPEATS;
+
+    NameTable decodedNames;
+    vector<PlanCommand> decoded;
+    bool ok = decodePlan(data, decodedNames, decoded);
+    start = Clock::now();
+    for (int r = 1; r < ENCODING_REPEATS; r++)
+    {
+        NameTable scratchNames;
+        vector<PlanCommand> scratch;
+        decodePlan(data, scratchNames, scratch);
+    }
+    double decodeMs = msSince(start) / max(ENCODING_REPEATS - 1, 1);
+
+    bool same = ok && decoded.size() == commands.size();
+    for (int i = 0; same && i < commands.size(); i++)
+    {
+        same = decoded[i].type == commands[i].type && decoded[i].direction == commands[i].direction &&
+               memcmp(&decoded[i].distance, &commands[i].distance, sizeof(float)) == 0 &&
+               decodedNames.name(decoded[i].name) == names.name(commands[i].name);
+    }
+    string again;
+    if (same)
+        encodePlan(decoded, decodedNames, again);
+    same = same && again == data;
+
+    vector<string> damaged;
+    for (size_t length = 0; length < data.size(); length++)
+        damaged.push_back(data.substr(0, length));
+    uint32_t nameCount = getU32(data, 8);
+    if (nameCount > 0)
+    {
+        string tooLong = data;
+        setU32(tooLong, 16, 0xFFFFFFFF);    // the first name's length
+        damaged.push_back(tooLong);
+    }
+    if (!commands.empty())
+    {
+        string badIndex = data;
+        setU32(badIndex, data.size() - 12 * commands.size() + 4, nameCount);   // the first command's name
+        damaged.push_back(badIndex);
+    }
+    int accepted = 0;
+    for (int k = 0; k < damaged.size(); k++)
+    {
+        NameTable untouchedNames;
+        vector<PlanCommand> untouched;
+        if (decodePlan(damaged[k], untouchedNames, untouched) || untouchedNames.size() != 0 || !untouched.empty())
+            accepted++;
+    }
+
+    string text;
+    formatCommands(commands, names, text);
+    report.integer("commands", static_cast<long long>(commands.size()));
+    report.integer("text_bytes", static_cast<long long>(text.size()));
+    report.integer("binary_bytes", static_cast<long long>(data.size()));
+    report.number("encode_ms", encodeMs, 4);
+    report.number("decode_ms", decodeMs, 4);
+    report.text("round_trip", same ? "ok" : "mismatch");
+    report.integer("damaged_forms", static_cast<long long>(damaged.size()));
+    report.integer("damaged_accepted", accepted);
+    cout << "plan encoding: " << commands.size() << " commands in " << data.size() << " bytes (text "
+         << text.size() << "), round trip " << (same ? "ok" : "MISMATCH") << ", " << accepted << " of "
+         << damaged.size() << " damaged forms accepted" << endl;
+    return same && accepted == 0;
+}
+
+  // Optimize stops with options, into the report object that's open: the
+  // time, the crow miles before and after, and the moves made.
+static void timeOptimizer(JsonReport& report, const StreetMap* sm, const GeoCoord& depot,
+                          vector<DeliveryRequest> stops, const OptimizerOptions& options)
+{
+    ConfigurableDeliveryOptimizer optimizer(sm, options);
+    double oldMiles;
+    double newMiles;
+    OptimizerStats stats;
+    Clock::time_point start = Clock::now();
+    optimizer.optimizeDeliveryOrder(depot, stops, oldMiles, newMiles, &stats);
+    report.number("ms", msSince(start), 3);
+    report.number("old_crow_miles", oldMiles, 4);
+    report.number("new_crow_miles", newMiles, 4);
+    report.integer("annealing_moves", stats.annealingMoves);
+    report.integer("local_search_moves", stats.localSearchMoves);
+}
+
+  // The deliveries file loader as it was before MappedDeliveries, kept to
+  // time the new one against: getline, then parseDelivery's substr and
+  // istringstream, for every line.
+static bool loadDeliveryRequestsWithStreams(string deliveriesFile, GeoCoord& depot, vector<DeliveryRequest>& v)
+{
+    ifstream inf(deliveriesFile);
+    if (!inf)
+        return false;
+    string lat;
+    string lon;
+    inf >> lat >> lon;
+    inf.ignore(10000, '\n');
+    depot = GeoCoord(lat, lon);
+    string line;
+    while (getline(inf, line))
+    {
+        string item;
+        if (parseDelivery(line, lat, lon, item))
+            v.push_back(DeliveryRequest(item, GeoCoord(lat, lon)));
+    }
+    return true;
+}
+
+static bool sameRequests(const vector<DeliveryRequest>& a, const vector<DeliveryRequest>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].item != b[i].item || a[i].location != b[i].location)
+            return false;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bool quick = false;
+    unsigned long long seed = 1;
+    int routeCount = -1;
+    string outFile = "benchmark.json";
+    int arg = 1;
+    while (arg < argc && string(argv[arg]).compare(0, 2, "--") == 0)
+    {
+        string flag = argv[arg];
+        if (flag == "--quick")
+            quick = true;
+        else if (flag == "--seed" && arg + 1 < argc)
+            seed = stoull(argv[++arg]);
+        else if (flag == "--routes" && arg + 1 < argc)
+            routeCount = stoi(argv[++arg]);
+        else if (flag == "--out" && arg + 1 < argc)
+            outFile = argv[++arg];
+        else
+            break;
+        arg++;
+    }
+    if (argc - arg < 1 || argc - arg > 2)
+    {
+        cout << "Usage: " << argv[0] << " [--quick] [--seed n] [--routes n] [--out results.json] mapdata.txt [deliveries.txt]" << endl;
+        return 1;
+    }
+    if (routeCount < 0)
+        routeCount = (quick ? QUICK_ROUTES : DEFAULT_ROUTES);
+    string mapFile = argv[arg];
+    string deliveriesFile = (argc - arg == 2 ? argv[arg + 1] : "");
+    if (deliveriesFile.empty())
+    {
+        size_t slash = mapFile.find_last_of('/');
+        deliveriesFile = (slash == string::npos ? "" : mapFile.substr(0, slash + 1)) + "deliveries.txt";
+    }
+
+    JsonReport report;
+    report.open("", '{');
+    report.text("map", mapFile);
+    report.text("deliveries", deliveriesFile);
+    report.integer("seed", static_cast<long long>(seed));
+
+      // Loading, a few times over: the first load also pays to read the file
+      // from disk.
+    StreetMap sm;
+    vector<double> loadTimes;
+    for (int k = 0; k < LOAD_REPEATS; k++)
+    {
+        StreetMap fresh;
+        Clock::time_point start = Clock::now();
+        if (!fresh.load(mapFile))
+        {
+            cout << "Unable to load map data file " << mapFile << endl;
+            return 1;
+        }
+        loadTimes.push_back(msSince(start));
+    }
+    sm.load(mapFile);
+    sort(loadTimes.begin(), loadTimes.end());
+    report.open("load", '{');
+    report.number("min_ms", loadTimes.front(), 3);
+    report.number("median_ms", percentile(loadTimes, 50), 3);
+    report.close('}');
+    cout << "load: " << loadTimes.front() << " ms" << endl;
+
+    GeoCoord depot;
+    vector<DeliveryRequest> bundled;
+    if (!loadDeliveryRequests(deliveriesFile, depot, bundled))
+    {
+        cout << "Unable to load delivery request file " << deliveriesFile << endl;
+        return 1;
+    }
+
+      // Everywhere reachable from the depot.
+    vector<GeoCoord> places;
+    {
+        StreetGraph graph(&sm);
+        int start = graph.nodeFor(depot);
+        if (start < 0)
+        {
+            cout << "The depot is not on the map." << endl;
+            return 1;
+        }
+        vector<int> reachable;
+        graph.reachableFrom(start, reachable);
+        for (int i = 0; i < reachable.size(); i++)
+            places.push_back(graph.coord(reachable[i]));
+    }
+    report.integer("reachable_nodes", static_cast<long long>(places.size()));
+    bool failed = false;
+
+      // The batch distance kernel against distanceEarthMiles(): pairs of
+      // places on the map, pairs inside EQUIRECTANGULAR's bounds anywhere on
+      // earth, then pairs anywhere at all (where only HAVERSINE is checked).
+    {
+        int pairs = (quick ? QUICK_KERNEL_PAIRS : KERNEL_PAIRS);
+        mt19937_64 rng(seed * 1000 + 900);
+        uniform_int_distribution<size_t> pick(0, places.size() - 1);
+        uniform_real_distribution<double> latitude(-89.9, 89.9);
+        uniform_real_distribution<double> longitude(-180, 180);
+        vector<GeoCoord> a;
+        vector<GeoCoord> b;
+        vector<GeoCoord> c;
+        vector<GeoCoord> d;
+        vector<GeoCoord> e;
+        vector<GeoCoord> f;
+          // Regional pairs: a second point up to this many degrees of latitude
+          // either way from the first, and the longitude that covers at its
+          // latitude, kept only if inside the bounds.
+        double reach = EQUIRECTANGULAR_MAX_MILES / 69.0;
+        uniform_real_distribution<double> regionLatitude(-EQUIRECTANGULAR_MAX_LATITUDE, EQUIRECTANGULAR_MAX_LATITUDE);
+        uniform_real_distribution<double> offset(-1, 1);
+        char lat[32];
+        char lon[32];
+        for (int k = 0; k < pairs; k++)
+        {
+            a.push_back(places[pick(rng)]);
+            b.push_back(places[pick(rng)]);
+            for (int end = 0; end < 2; end++)
+            {
+                snprintf(lat, sizeof(lat), "%.7f", latitude(rng));
+                snprintf(lon, sizeof(lon), "%.7f", longitude(rng));
+                (end == 0 ? e : f).push_back(GeoCoord(lat, lon));
+            }
+        }
+        while (c.size() < pairs)
+        {
+            double lat1 = regionLatitude(rng);
+            double lon1 = longitude(rng);
+            double lat2 = lat1 + offset(rng) * reach;
+            double lon2 = lon1 + offset(rng) * reach / cos(deg2rad(fabs(lat1) + reach));
+            if (fabs(lat2) > EQUIRECTANGULAR_MAX_LATITUDE)
+                continue;
+            snprintf(lat, sizeof(lat), "%.7f", lat1);
+            snprintf(lon, sizeof(lon), "%.7f", lon1);
+            GeoCoord one(lat, lon);
+            snprintf(lat, sizeof(lat), "%.7f", lat2);
+            snprintf(lon, sizeof(lon), "%.7f", lon2 > 180 ? lon2 - 360 : (lon2 < -180 ? lon2 + 360 : lon2));
+            GeoCoord two(lat, lon);
+            if (distanceEarthMiles(one, two) > EQUIRECTANGULAR_MAX_MILES)
+                continue;
+            c.push_back(one);
+            d.push_back(two);
+        }
+        report.open("distance_kernel", '{');
+        report.text("path", distanceKernelUsesAVX2() ? "avx2" : "scalar");
+        double mapError;
+        double mapFlatError;
+        double regionError;
+        double regionFlatError;
+        double worldError;
+        double worldFlatError;
+        benchmarkKernel(report, "map", a, b, mapError, mapFlatError);
+        benchmarkKernel(report, "region", c, d, regionError, regionFlatError);
+        benchmarkKernel(report, "world", e, f, worldError, worldFlatError);
+        report.close('}');
+        if (mapError > KERNEL_TOLERANCE || regionError > KERNEL_TOLERANCE || worldError > KERNEL_TOLERANCE)
+        {
+            cout << "The distance kernel is off by more than " << KERNEL_TOLERANCE << " of the distance." << endl;
+            failed = true;
+        }
+        if (mapFlatError > EQUIRECTANGULAR_MAX_ERROR || regionFlatError > EQUIRECTANGULAR_MAX_ERROR)
+        {
+            cout << "The equirectangular kernel is off by more than " << EQUIRECTANGULAR_MAX_ERROR
+                 << " of the distance inside its bounds." << endl;
+            failed = true;
+        }
+    }
+
+      // Reading a large deliveries file, the old way and through
+      // MappedDeliveries. The file is written first, so both read it from
+      // the page cache.
+    {
+        int lines = (quick ? QUICK_INGEST_LINES : INGEST_LINES);
+        string ingestFile = outFile + ".deliveries.tmp";
+        mt19937_64 rng(seed * 1000 + 950);
+        {
+            ofstream out(ingestFile);
+            out << depot.latitudeText << " " << depot.longitudeText << "\n";
+            vector<DeliveryRequest> stops = randomStops(places, lines, rng);
+            for (int i = 0; i < stops.size(); i++)
+                out << stops[i].location.latitudeText << " " << stops[i].location.longitudeText << ":"
+                    << stops[i].item << " (" << i % 97 << " Westwood Plaza)\n";
+        }
+
+        GeoCoord oldDepot;
+        vector<DeliveryRequest> oldRequests;
+        Clock::time_point start = Clock::now();
+        bool oldLoaded = loadDeliveryRequestsWithStreams(ingestFile, oldDepot, oldRequests);
+        double streamsMs = msSince(start);
+
+        GeoCoord newDepot;
+        vector<DeliveryRequest> newRequests;
+        MappedDeliveries mapped;
+        start = Clock::now();
+        bool newLoaded = mapped.open(ingestFile);
+        double splitMs = msSince(start);
+        start = Clock::now();
+        newLoaded = newLoaded && mapped.toRequests(newDepot, newRequests);
+        double requestsMs = msSince(start);
+        remove(ingestFile.c_str());
+
+        bool same = oldLoaded && newLoaded && oldDepot == newDepot && sameRequests(oldRequests, newRequests);
+        report.open("ingest", '{');
+        report.integer("lines", lines);
+        report.number("streams_ms", streamsMs, 3);
+        report.number("map_split_ms", splitMs, 3);
+        report.number("to_requests_ms", requestsMs, 3);
+        report.text("same_requests", same ? "yes" : "no");
+        report.close('}');
+        cout << "ingest: " << lines << " lines in " << streamsMs << " ms with streams, "
+             << splitMs + requestsMs << " ms mapped" << endl;
+        if (!same)
+        {
+            cout << "The two deliveries file loaders disagree." << endl;
+            failed = true;
+        }
+    }
+
+      // Point-to-point routes, and compiling them all into commands as one
+      // long drive.
+    {
+        CountingRouter router(&sm);
+        mt19937_64 rng(seed);
+        uniform_int_distribution<size_t> pick(0, places.size() - 1);
+        vector<double> times;
+        double miles = 0;
+        list<StreetSegment> chained;
+        vector<GeoCoord> ends;
+        for (int k = 0; k < routeCount; k++)
+        {
+            const GeoCoord& from = places[pick(rng)];
+            const GeoCoord& to = places[pick(rng)];
+            list<StreetSegment> route;
+            double totalDist = 0;
+            Clock::time_point start = Clock::now();
+            router.generatePointToPointRoute(from, to, route, totalDist, nullptr);
+            times.push_back(msSince(start));
+            miles += totalDist;
+            chained.splice(chained.end(), route);
+            ends.push_back(from);
+            ends.push_back(to);
+        }
+        RouteStats stats;
+        for (int k = 0; k + 1 < ends.size(); k += 2)
+        {
+            list<StreetSegment> route;
+            double totalDist = 0;
+            router.generatePointToPointRoute(ends[k], ends[k + 1], route, totalDist, &stats);
+        }
+        double total = 0;
+        for (int k = 0; k < times.size(); k++)
+            total += times[k];
+        sort(times.begin(), times.end());
+        report.open("routes", '{');
+        report.integer("count", routeCount);
+        report.number("total_ms", total, 3);
+        report.number("mean_ms", (times.empty() ? 0 : total / times.size()), 3);
+        report.number("p50_ms", percentile(times, 50), 3);
+        report.number("p95_ms", percentile(times, 95), 3);
+        report.number("max_ms", (times.empty() ? 0 : times.back()), 3);
+        report.number("miles", miles, 4);
+        report.integer("nodes_settled", stats.nodesSettled);
+        report.integer("edges_relaxed", stats.edgesRelaxed);
+        report.integer("heap_pushes", stats.heapPushes);
+        report.integer("heap_pops", stats.heapPops);
+        report.integer("hash_probes", stats.hashProbes);
+        report.close('}');
+        cout << "routes: " << routeCount << " in " << total << " ms" << endl;
+
+        NameTable names;
+        vector<PlanCommand> commands;
+        double commandMiles = 0;
+        Clock::time_point start = Clock::now();
+        compileLeg(chained, names, commands, commandMiles);
+        report.open("commands", '{');
+        report.integer("segments", static_cast<long long>(chained.size()));
+        report.integer("commands", static_cast<long long>(commands.size()));
+        report.number("ms", msSince(start), 3);
+        report.close('}');
+    }
+
+    OptimizerOptions optimizerOptions;
+    optimizerOptions.useSeed = true;
+    optimizerOptions.seed = seed;
+
+    report.open("optimizer", '[');
+    for (int s = 0; s < sizeof(OPTIMIZER_SIZES) / sizeof(OPTIMIZER_SIZES[0]); s++)
+    {
+        int n = OPTIMIZER_SIZES[s];
+        if (quick && n > QUICK_MAX_STOPS)
+            break;
+        mt19937_64 rng(seed * 1000 + n);
+        vector<DeliveryRequest> stops = randomStops(places, n, rng);
+        ConfigurableDeliveryOptimizer optimizer(&sm, optimizerOptions);
+        double oldMiles;
+        double newMiles;
+        OptimizerStats stats;
+        Clock::time_point start = Clock::now();
+        optimizer.optimizeDeliveryOrder(depot, stops, oldMiles, newMiles, &stats);
+        double ms = msSince(start);
+        report.open("", '{');
+        report.integer("stops", n);
+        report.number("ms", ms, 3);
+        report.number("old_crow_miles", oldMiles, 4);
+        report.number("new_crow_miles", newMiles, 4);
+        report.integer("annealing_moves", stats.annealingMoves);
+        report.number("acceptance_rate", stats.acceptanceRate(), 4);
+        report.integer("local_search_moves", stats.localSearchMoves);
+        report.close('}');
+        cout << "optimizer: " << n << " stops in " << ms << " ms" << endl;
+    }
+    report.close(']');
+
+      // Annealing alone on the same stops with 1..N threads in each parallel
+      // mode, for tour quality against time. N is the number of cores, but
+      // at least 2 so tempering has two replicas to exchange between.
+    {
+        int n = (quick ? QUICK_MAX_STOPS : THREAD_SWEEP_STOPS);
+        int maxThreads = max(static_cast<int>(thread::hardware_concurrency()), 2);
+        mt19937_64 rng(seed * 1000 + 600);
+        vector<DeliveryRequest> stops = randomStops(places, n, rng);
+        report.open("optimizer_threads", '[');
+        for (int mode = 0; mode < 2; mode++)
+        {
+            for (int t = 0; t < sizeof(THREAD_SWEEP) / sizeof(THREAD_SWEEP[0]) && THREAD_SWEEP[t] <= maxThreads; t++)
+            {
+                OptimizerOptions options = optimizerOptions;
+                options.strategy = ANNEALING;
+                options.parallelMode = (mode == 0 ? MULTI_START : PARALLEL_TEMPERING);
+                options.threads = THREAD_SWEEP[t];
+                report.open("", '{');
+                report.text("mode", mode == 0 ? "multi_start" : "parallel_tempering");
+                report.integer("threads", options.threads);
+                report.integer("stops", n);
+                timeOptimizer(report, &sm, depot, stops, options);
+                report.close('}');
+            }
+        }
+        report.close(']');
+        cout << "optimizer threads: " << n << " stops, up to " << maxThreads << " threads" << endl;
+    }
+
+      // Held-Karp against the default search on the same small batches, to
+      // check where OptimizerOptions::exactThreshold should be: exact is
+      // worth it while it's about as fast.
+    report.open("exact_crossover", '[');
+    for (int n = EXACT_SWEEP_MIN_STOPS; n <= (quick ? QUICK_EXACT_SWEEP_MAX_STOPS : EXACT_SWEEP_MAX_STOPS); n++)
+    {
+        mt19937_64 rng(seed * 1000 + 700 + n);
+        vector<DeliveryRequest> stops = randomStops(places, n, rng);
+        OptimizerOptions exact = optimizerOptions;
+        exact.exactThreshold = HELD_KARP_MAX_STOPS;
+        OptimizerOptions search = optimizerOptions;
+        search.exactThreshold = 0;
+        report.open("", '{');
+        report.integer("stops", n);
+        report.open("exact", '{');
+        timeOptimizer(report, &sm, depot, stops, exact);
+        report.close('}');
+        report.open("search", '{');
+        timeOptimizer(report, &sm, depot, stops, search);
+        report.close('}');
+        report.close('}');
+    }
+    report.close(']');
+    cout << "exact crossover: " << EXACT_SWEEP_MIN_STOPS << " to "
+         << (quick ? QUICK_EXACT_SWEEP_MAX_STOPS : EXACT_SWEEP_MAX_STOPS) << " stops" << endl;
+
+      // Each search strategy on the same stops, for quality against time.
+    report.open("strategies", '[');
+    for (int s = 0; s < sizeof(STRATEGY_SIZES) / sizeof(STRATEGY_SIZES[0]); s++)
+    {
+        int n = STRATEGY_SIZES[s];
+        if (quick && n > QUICK_MAX_STOPS)
+            break;
+        mt19937_64 rng(seed * 1000 + 800 + n);
+        vector<DeliveryRequest> stops = randomStops(places, n, rng);
+        const SearchStrategy strategies[] = { ANNEALING, ANNEALING_THEN_LOCAL_SEARCH, LOCAL_SEARCH };
+        const char* names[] = { "annealing", "annealing_then_local_search", "local_search" };
+        for (int k = 0; k < 3; k++)
+        {
+            OptimizerOptions options = optimizerOptions;
+            options.strategy = strategies[k];
+            report.open("", '{');
+            report.text("strategy", names[k]);
+            report.integer("stops", n);
+            timeOptimizer(report, &sm, depot, stops, options);
+            report.close('}');
+        }
+        cout << "strategies: " << n << " stops" << endl;
+    }
+    report.close(']');
+
+      // Large batches searched whole and in clusters of CLUSTER_STOPS, for
+      // how each scales with the batch.
+    report.open("clustering", '[');
+    for (int s = 0; s < sizeof(CLUSTER_SIZES) / sizeof(CLUSTER_SIZES[0]); s++)
+    {
+        int n = CLUSTER_SIZES[s];
+        if (quick && n > QUICK_MAX_STOPS)
+            break;
+        mt19937_64 rng(seed * 1000 + 850 + n);
+        vector<DeliveryRequest> stops = randomStops(places, n, rng);
+        for (int clustered = 0; clustered < 2; clustered++)
+        {
+            OptimizerOptions options = optimizerOptions;
+            options.clusterSize = (clustered ? CLUSTER_STOPS : 0);
+            report.open("", '{');
+            report.integer("stops", n);
+            report.integer("cluster_size", options.clusterSize);
+            timeOptimizer(report, &sm, depot, stops, options);
+            report.close('}');
+        }
+        cout << "clustering: " << n << " stops" << endl;
+    }
+    report.close(']');
+
+      // Whole plans: the bundled deliveries, then random ones.
+    PlannerOptions plannerOptions;
+    plannerOptions.optimizer = optimizerOptions;
+    ConfigurableDeliveryPlanner planner(&sm, plannerOptions);
+    report.open("plan", '[');
+    for (int s = -1; s < static_cast<int>(sizeof(PLAN_SIZES) / sizeof(PLAN_SIZES[0])); s++)
+    {
+        if (s >= 0 && quick && PLAN_SIZES[s] > QUICK_MAX_STOPS)
+            break;
+        mt19937_64 rng(seed * 1000 + 500 + (s < 0 ? 0 : PLAN_SIZES[s]));
+        vector<DeliveryRequest> stops = (s < 0 ? bundled : randomStops(places, PLAN_SIZES[s], rng));
+        vector<DeliveryCommand> commands;
+        double miles = 0;
+        Clock::time_point start = Clock::now();
+        DeliveryResult result = planner.generateDeliveryPlan(depot, stops, commands, miles);
+        double ms = msSince(start);
+        report.open("", '{');
+        report.text("input", s < 0 ? "bundled" : "random");
+        report.integer("stops", static_cast<long long>(stops.size()));
+        report.text("result", result == DELIVERY_SUCCESS ? "ok" : (result == BAD_COORD ? "bad_coord" : "no_route"));
+        report.number("ms", ms, 3);
+        report.number("miles", miles, 4);
+        report.integer("commands", static_cast<long long>(commands.size()));
+        report.close('}');
+        cout << "plan: " << stops.size() << " stops in " << ms << " ms" << endl;
+    }
+    report.close(']');
+
+      // A plan through its binary form and back (see PlanEncoding.h).
+    {
+        mt19937_64 rng(seed * 1000 + 980);
+        vector<DeliveryRequest> stops = randomStops(places, ENCODING_STOPS, rng);
+        NameTable names;
+        vector<PlanCommand> commands;
+        auto keepLeg = [&commands](int /*leg*/, const vector<PlanCommand>& legCommands, double /*legMiles*/)
+        {
+            commands.insert(commands.end(), legCommands.begin(), legCommands.end());
+        };
+        planner.streamDeliveryPlan(depot, stops, names, keepLeg);
+        report.open("plan_encoding", '{');
+        report.integer("stops", ENCODING_STOPS);
+        if (!checkPlanEncoding(report, commands, names))
+        {
+            cout << "A plan didn't survive the trip through its binary form." << endl;
+            failed = true;
+        }
+        report.close('}');
+    }
+    report.close('}');
+
+    ofstream outf(outFile);
+    outf << report.str() << endl;
+    if (!outf)
+    {
+        cout << "Unable to write " << outFile << endl;
+        return 1;
+    }
+    cout << "Wrote " << outFile << endl;
+    return (failed ? 1 : 0);
+}
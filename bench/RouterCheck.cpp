@@ -0,0 +1,455 @@
+#include "provided.h"
+#include "ReferenceRouter.h"
+#include "RoadMatrix.h"
+#include "StreetGraph.h"
+#include "DeliveryFile.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Checks every routing engine against ReferenceRouter on random pairs of
+// nodes, and times them all on the same pairs.
+//
+// Usage: RouterCheck [--pairs n | --sources n [--targets m]] [--threads n] [--seed n] [--show n]
+//                    mapdata.txt [deliveries.txt]
+//
+// Pairs are drawn, with the seed, from the nodes that can be driven to from
+// the deliveries file's depot. For each pair, an engine's answer is wrong if
+// its result differs from the reference's, its miles differ by more than
+// rounding, or the route it returns isn't a connected path between the two
+// nodes whose length is the miles it reported. The first few wrong answers
+// are printed in full; the exit status is 1 if there were any.
+//
+// With --pairs the reference routes every pair itself, a std::map search of
+// about 35 ms each on the Westwood map, and so does the road-matrix engine,
+// so a pair costs about 80 ms in all. With --sources each of n random sources
+// is checked against m random targets (every reachable node if m is 0): the
+// reference makes one search from the source that settles the whole map, and
+// the road-matrix engine one search that settles every target, so a pair
+// costs little more than the A* engine's own route, about 12 ms. Pairs are
+// spread over --threads threads (by default, one per core), each with its own
+// engines. On one core that's about 700 pairs a minute with --pairs and 5,000
+// with --sources; a million pairs is --sources 1000 --targets 1000, about
+// three core-hours.
+//
+// Times are per pair. An engine's mean includes the searches it makes once
+// per source, spread over that source's targets; its percentiles are of the
+// time each pair took on its own. In --sources mode, the reference's
+// percentiles are of its searches, one per source.
+//
+// To check a new engine, add it to the list in makeEngines().
+
+const int DEFAULT_PAIRS = 200;
+const int DEFAULT_TARGETS = 1000;
+const int DEFAULT_SHOW = 5;
+const int PROGRESS_INTERVAL = 1000;
+
+  // Miles that differ by less than this fraction are the same distance summed
+  // in a different order.
+const double TOLERANCE = 1e-9;
+
+typedef chrono::steady_clock Clock;
+typedef function<DeliveryResult(const GeoCoord&, const GeoCoord&, list<StreetSegment>&, double&)> RouteFunction;
+typedef function<void(const GeoCoord&, const vector<DeliveryRequest>&)> SourceFunction;
+
+struct Engine
+{
+    string name;
+    RouteFunction route;
+    SourceFunction prepare;     // if set, called with each source and its targets before they're routed
+    vector<double> times;       // ms, one per pair (per source for the reference with --sources)
+    double prepareMs;
+    long long pairs;
+    long long wrongResult;
+    long long wrongMiles;
+    long long badRoute;
+    double maxError;            // miles over (or under) the reference
+};
+
+  // Wrong answers printed so far, shared by every thread.
+struct ProblemLog
+{
+    mutex lock;
+    int shown;
+    int show;
+};
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    int rank = static_cast<int>(ceil(p / 100 * sorted.size()));
+    return sorted[max(rank, 1) - 1];
+}
+
+static bool sameMiles(double a, double b)
+{
+    return fabs(a - b) <= TOLERANCE * max(1.0, fabs(b));
+}
+
+static const char* resultName(DeliveryResult r)
+{
+    return (r == DELIVERY_SUCCESS ? "ok" : (r == BAD_COORD ? "bad_coord" : "no_route"));
+}
+
+  // Run every engine from engines[first] on from -> to, checking each against
+  // expected (and, for the reference, setting it). Wrong answers are printed
+  // until the log has shown as many as it should.
+static void checkPair(vector<Engine>& engines, int first, const GeoCoord& from, const GeoCoord& to,
+                      DeliveryResult expected, double expectedMiles, ProblemLog& log)
+{
+    for (int e = first; e < engines.size(); e++)
+    {
+        Engine& engine = engines[e];
+        list<StreetSegment> route;
+        double miles = 0;
+        Clock::time_point start = Clock::now();
+        DeliveryResult result = engine.route(from, to, route, miles);
+        engine.times.push_back(msSince(start));
+        engine.pairs++;
+
+        string problem;
+        double length = routeLength(route, from, to);
+        if (result == DELIVERY_SUCCESS && (length < 0 || !sameMiles(length, miles)))
+        {
+            engine.badRoute++;
+            problem = (length < 0 ? "route isn't a path between the pair" : "route's length isn't the miles reported");
+        }
+        if (e == 0)
+        {
+            expected = result;
+            expectedMiles = miles;
+        }
+        else if (result != expected)
+        {
+            engine.wrongResult++;
+            problem = string("result ") + resultName(result) + ", expected " + resultName(expected);
+        }
+        else if (result == DELIVERY_SUCCESS && !sameMiles(miles, expectedMiles))
+        {
+            engine.wrongMiles++;
+            engine.maxError = max(engine.maxError, fabs(miles - expectedMiles));
+            char buf[96];
+            snprintf(buf, sizeof(buf), "%.6f miles, expected %.6f", miles, expectedMiles);
+            problem = buf;
+        }
+        if (!problem.empty())
+        {
+            lock_guard<mutex> lock(log.lock);
+            if (log.shown < log.show)
+            {
+                log.shown++;
+                cout << engine.name << ": " << from.latitudeText << " " << from.longitudeText << " to "
+                     << to.latitudeText << " " << to.longitudeText << ": " << problem << endl;
+            }
+        }
+    }
+}
+
+static Engine makeEngine(const string& name, const RouteFunction& route, const SourceFunction& prepare = SourceFunction())
+{
+    Engine e;
+    e.name = name;
+    e.route = route;
+    e.prepare = prepare;
+    e.prepareMs = 0;
+    e.pairs = 0;
+    e.wrongResult = e.wrongMiles = e.badRoute = 0;
+    e.maxError = 0;
+    return e;
+}
+
+  // The road-matrix engine's search from the current source, if there is
+  // one: where each target is in it, and the miles to each.
+struct SourceTree
+{
+    SourceTree(const StreetMap* sm) : road(sm), built(false) {}
+    RoadMatrix road;
+    bool built;
+    GeoCoord from;
+    map<GeoCoord, int> index;
+    vector<double> miles;
+};
+
+  // One set of engines, for one thread; engines[0] is the reference. The
+  // routers are shared by the lambdas that use them, so the set can be copied.
+static vector<Engine> makeEngines(const StreetMap* sm)
+{
+    shared_ptr<ReferenceRouter> reference = make_shared<ReferenceRouter>(sm);
+    shared_ptr<PointToPointRouter> astar = make_shared<PointToPointRouter>(sm);
+    shared_ptr<SourceTree> tree = make_shared<SourceTree>(sm);
+    vector<Engine> engines;
+    engines.push_back(makeEngine("reference", [reference](const GeoCoord& a, const GeoCoord& b, list<StreetSegment>& route, double& miles)
+    {
+        return reference->generatePointToPointRoute(a, b, route, miles);
+    }));
+    engines.push_back(makeEngine("a-star", [astar](const GeoCoord& a, const GeoCoord& b, list<StreetSegment>& route, double& miles)
+    {
+        return astar->generatePointToPointRoute(a, b, route, miles);
+    }));
+      // With --sources, one search from each source answers all its targets;
+      // otherwise each pair gets a matrix of its own.
+    engines.push_back(makeEngine("road-matrix", [sm, tree](const GeoCoord& a, const GeoCoord& b, list<StreetSegment>& route, double& miles)
+    {
+        map<GeoCoord, int>::const_iterator it = tree->index.find(b);
+        if (tree->built && tree->from == a && it != tree->index.end())
+        {
+            route.clear();
+            miles = 0;
+            if (tree->miles[it->second] == numeric_limits<double>::infinity())
+                return NO_ROUTE;
+            tree->road.route(0, it->second + 1, route, miles);
+            return DELIVERY_SUCCESS;
+        }
+        RoadMatrix road(sm);
+        DeliveryResult result = road.build(a, vector<DeliveryRequest>(1, DeliveryRequest("", b)));
+        if (result == DELIVERY_SUCCESS)
+            road.route(0, 1, route, miles);
+        return result;
+    },
+    [tree](const GeoCoord& from, const vector<DeliveryRequest>& targets)
+    {
+        tree->from = from;
+        tree->index.clear();
+        tree->built = (tree->road.buildFrom(from, targets, tree->miles) == DELIVERY_SUCCESS);
+        for (int i = 0; tree->built && i < targets.size(); i++)
+            tree->index[targets[i].location] = i;
+    }));
+    return engines;
+}
+
+int main(int argc, char* argv[])
+{
+    long long pairs = DEFAULT_PAIRS;
+    int sources = 0;
+    int targets = DEFAULT_TARGETS;
+    int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    unsigned long long seed = 1;
+    int show = DEFAULT_SHOW;
+    int arg = 1;
+    while (arg < argc && string(argv[arg]).compare(0, 2, "--") == 0)
+    {
+        string flag = argv[arg];
+        if (flag == "--pairs" && arg + 1 < argc)
+            pairs = stoll(argv[++arg]);
+        else if (flag == "--sources" && arg + 1 < argc)
+            sources = stoi(argv[++arg]);
+        else if (flag == "--targets" && arg + 1 < argc)
+            targets = stoi(argv[++arg]);
+        else if (flag == "--threads" && arg + 1 < argc)
+            threads = max(1, stoi(argv[++arg]));
+        else if (flag == "--seed" && arg + 1 < argc)
+            seed = stoull(argv[++arg]);
+        else if (flag == "--show" && arg + 1 < argc)
+            show = stoi(argv[++arg]);
+        else
+            break;
+        arg++;
+    }
+    if (argc - arg < 1 || argc - arg > 2)
+    {
+        cout << "Usage: " << argv[0] << " [--pairs n | --sources n [--targets m]] [--threads n] [--seed n] [--show n]"
+             << " mapdata.txt [deliveries.txt]" << endl;
+        cout << "  --pairs n routes each pair with the reference too; about 80 ms a pair." << endl;
+        cout << "  --sources n checks m targets (default " << DEFAULT_TARGETS << ", 0 for all) from each source"
+             << " against one reference search; about 12 ms a pair." << endl;
+        cout << "  Those are per thread on the Westwood map; a million pairs with --sources is about"
+             << " three core-hours." << endl;
+        return 1;
+    }
+    string mapFile = argv[arg];
+    string deliveriesFile = (argc - arg == 2 ? argv[arg + 1] : "");
+    if (deliveriesFile.empty())
+    {
+        size_t slash = mapFile.find_last_of('/');
+        deliveriesFile = (slash == string::npos ? "" : mapFile.substr(0, slash + 1)) + "deliveries.txt";
+    }
+
+    StreetMap sm;
+    if (!sm.load(mapFile))
+    {
+        cout << "Unable to load map data file " << mapFile << endl;
+        return 1;
+    }
+    GeoCoord depot;
+    vector<DeliveryRequest> deliveries;
+    if (!loadDeliveryRequests(deliveriesFile, depot, deliveries))
+    {
+        cout << "Unable to load delivery request file " << deliveriesFile << endl;
+        return 1;
+    }
+
+    vector<GeoCoord> places;
+    {
+        StreetGraph graph(&sm);
+        int start = graph.nodeFor(depot);
+        if (start < 0)
+        {
+            cout << "The depot is not on the map." << endl;
+            return 1;
+        }
+        vector<int> reachable;
+        graph.reachableFrom(start, reachable);
+        for (int i = 0; i < reachable.size(); i++)
+            places.push_back(graph.coord(reachable[i]));
+    }
+
+      // Every pair is drawn before any is checked, so the pairs don't depend
+      // on how the threads share them out. A job is one source and its targets
+      // (with --pairs, one pair); with every node as a target none are drawn.
+    bool oneToMany = (sources > 0);
+    bool allTargets = oneToMany && (targets <= 0 || targets >= places.size());
+    if (allTargets)
+        targets = static_cast<int>(places.size());
+    long long jobs = (oneToMany ? sources : pairs);
+    int perJob = (oneToMany ? targets : 1);
+    mt19937_64 rng(seed);
+    uniform_int_distribution<size_t> pick(0, places.size() - 1);
+    vector<size_t> fromPick(jobs);
+    vector<size_t> toPick(allTargets ? 0 : jobs * perJob);
+    for (long long j = 0; j < jobs; j++)
+    {
+        fromPick[j] = pick(rng);
+        for (int t = 0; !allTargets && t < perJob; t++)
+            toPick[j * perJob + t] = pick(rng);
+    }
+
+    WorkerPool pool(threads);
+    vector<vector<Engine> > threadEngines(pool.size());
+    for (int k = 0; k < pool.size(); k++)
+        threadEngines[k] = makeEngines(&sm);
+    if (oneToMany)
+        cout << "Checking " << threadEngines[0].size() - 1 << " engines on " << targets << " targets from each of "
+             << sources << " sources, among " << places.size() << " reachable nodes, on " << pool.size()
+             << " threads (seed " << seed << ")" << endl;
+    else
+        cout << "Checking " << threadEngines[0].size() - 1 << " engines on " << pairs << " pairs from "
+             << places.size() << " reachable nodes, on " << pool.size() << " threads (seed " << seed << ")" << endl;
+
+    ProblemLog log;
+    log.shown = 0;
+    log.show = show;
+    atomic<long long> nextJob(0);
+    atomic<long long> checked(0);
+    pool.run(pool.size(), [&](int k)
+    {
+        vector<Engine>& engines = threadEngines[k];
+        ReferenceRouter reference(&sm);
+        map<GeoCoord, double> reachedMiles;
+        vector<StreetSegment> segs;
+        vector<DeliveryRequest> jobTargets;
+        for (long long j = nextJob++; j < jobs; j = nextJob++)
+        {
+            const GeoCoord& from = places[fromPick[j]];
+            jobTargets.clear();
+            for (int t = 0; t < perJob; t++)
+                jobTargets.push_back(DeliveryRequest("", places[allTargets ? t : toPick[j * perJob + t]]));
+
+            DeliveryResult fromResult = DELIVERY_SUCCESS;
+            if (oneToMany)
+            {
+                Clock::time_point start = Clock::now();
+                fromResult = reference.milesFrom(from, reachedMiles);
+                engines[0].times.push_back(msSince(start));
+                engines[0].pairs += perJob;
+                for (int e = 1; e < engines.size(); e++)
+                {
+                    if (!engines[e].prepare)
+                        continue;
+                    start = Clock::now();
+                    engines[e].prepare(from, jobTargets);
+                    engines[e].prepareMs += msSince(start);
+                }
+            }
+            for (int t = 0; t < perJob; t++)
+            {
+                const GeoCoord& to = jobTargets[t].location;
+                if (!oneToMany)
+                    checkPair(engines, 0, from, to, DELIVERY_SUCCESS, 0, log);
+                else
+                {
+                    DeliveryResult expected = fromResult;
+                    double expectedMiles = 0;
+                    if (expected == DELIVERY_SUCCESS && !sm.getSegmentsThatStartWith(to, segs))
+                        expected = BAD_COORD;
+                    else if (expected == DELIVERY_SUCCESS)
+                    {
+                        map<GeoCoord, double>::const_iterator it = reachedMiles.find(to);
+                        if (it == reachedMiles.end())
+                            expected = NO_ROUTE;
+                        else
+                            expectedMiles = it->second;
+                    }
+                    checkPair(engines, 1, from, to, expected, expectedMiles, log);
+                }
+                if (++checked % PROGRESS_INTERVAL == 0)
+                {
+                    lock_guard<mutex> lock(log.lock);
+                    cerr << checked << " pairs checked" << endl;
+                }
+            }
+        }
+    });
+
+      // Gather every thread's counts and times into the first thread's engines.
+    vector<Engine>& engines = threadEngines[0];
+    for (int k = 1; k < threadEngines.size(); k++)
+    {
+        for (int e = 0; e < engines.size(); e++)
+        {
+            Engine& from = threadEngines[k][e];
+            Engine& to = engines[e];
+            to.times.insert(to.times.end(), from.times.begin(), from.times.end());
+            to.prepareMs += from.prepareMs;
+            to.pairs += from.pairs;
+            to.wrongResult += from.wrongResult;
+            to.wrongMiles += from.wrongMiles;
+            to.badRoute += from.badRoute;
+            to.maxError = max(to.maxError, from.maxError);
+        }
+    }
+
+    double referenceMean = 0;
+    long long wrong = 0;
+    char line[256];
+    snprintf(line, sizeof(line), "%-12s %10s %10s %10s %10s %10s %10s %10s %10s %9s",
+             "engine", "wrong res", "wrong mi", "bad route", "max err", "mean ms", "p50 ms", "p95 ms", "max ms", "speedup");
+    cout << line << endl;
+    for (int e = 0; e < engines.size(); e++)
+    {
+        Engine& engine = engines[e];
+        double total = engine.prepareMs;
+        for (int k = 0; k < engine.times.size(); k++)
+            total += engine.times[k];
+        double mean = (engine.pairs == 0 ? 0 : total / engine.pairs);
+        if (e == 0)
+            referenceMean = mean;
+        sort(engine.times.begin(), engine.times.end());
+        wrong += engine.wrongResult + engine.wrongMiles + engine.badRoute;
+        snprintf(line, sizeof(line), "%-12s %10lld %10lld %10lld %10.6f %10.3f %10.3f %10.3f %10.3f %8.2fx",
+                 engine.name.c_str(), engine.wrongResult, engine.wrongMiles, engine.badRoute, engine.maxError,
+                 mean, percentile(engine.times, 50), percentile(engine.times, 95),
+                 (engine.times.empty() ? 0 : engine.times.back()), (mean > 0 ? referenceMean / mean : 0));
+        cout << line << endl;
+    }
+    return (wrong > 0 ? 1 : 0);
+}